@@ -94,6 +94,36 @@ static t_timelevel timelevel[AXIS_ARRAY_SIZE];
  * generated one, if automatic tic placement is active */
 static double ticstep[AXIS_ARRAY_SIZE];
 
+/* gen_tics() is called several times per plot for the same axis (label
+ * width estimate, tic marks, grid, mirrored tics, ...).  Each call used to
+ * redo the tic placement and re-format every label.  The first call now
+ * records the tics of an axis in tic_cache[], together with a key that
+ * describes everything the placement and formatting depend on; later calls
+ * with an unchanged key just replay the recorded tics to the callback.
+ */
+#define TIC_GRID_MAJOR 0	/* draw with the major grid style */
+#define TIC_GRID_MINOR 1	/* draw with the minor grid style */
+#define TIC_GRID_NONE  2	/* major tic, but no grid line (mirrored polar tic) */
+
+struct tic_record {
+    double place;		/* internal coordinate passed to the callback */
+    int label;			/* offset into tic_cache.labels, or -1 for NULL */
+    int level;			/* 0 = major, 1 = minor, >1 = user levels */
+    int grid;			/* TIC_GRID_* */
+    TBOOLEAN userlist;		/* pass ticdef.def.user as last argument */
+};
+
+static struct tic_cache {
+    TBOOLEAN valid;		/* the records below belong to key[] */
+    TBOOLEAN recording;		/* gen_tics is filling the records */
+    char *key;			/* byte string built by tic_cache_lookup */
+    size_t keylen;
+    struct tic_record *tics;
+    int n_tics, max_tics;
+    char *labels;		/* all label strings, NUL separated */
+    size_t labels_used, labels_size;
+} tic_cache[AXIS_ARRAY_SIZE];
+
 /* HBB 20000506 new variable: parsing table for use with the table
  * module, to help generalizing set/show/unset/save, where possible */
 const struct gen_table axisname_tbl[AXIS_ARRAY_SIZE + 1] =
@@ -171,6 +201,11 @@ static TBOOLEAN axis_position_zeroaxis __PROTO((AXIS_INDEX));
 static void load_one_range __PROTO((AXIS_INDEX axis, double *a, t_autoscale *autoscale, t_autoscale which ));
 static double quantize_duodecimal_tics __PROTO((double, int));
 static void get_position_type __PROTO((enum position_type * type, int *axes));
+static void generate_tics __PROTO((AXIS_INDEX, tic_callback));
+static TBOOLEAN tic_cache_lookup __PROTO((AXIS_INDEX));
+static void tic_cache_store __PROTO((AXIS_INDEX, double, char *, int, int, TBOOLEAN));
+static void tic_cache_replay __PROTO((AXIS_INDEX, tic_callback,
+				      struct lp_style_type, struct lp_style_type));
 
 /* ---------------------- routines ----------------------- */
 
@@ -890,6 +925,192 @@ setup_tics(AXIS_INDEX axis, int max)
 
 /* }}} */
 
+/* {{{ tic cache */
+static char *tic_key = NULL;
+static size_t tic_key_len, tic_key_size;
+
+static void
+tic_key_add(const void *data, size_t len)
+{
+    if (tic_key_len + len > tic_key_size) {
+	tic_key_size = 2 * (tic_key_len + len) + 256;
+	tic_key = gp_realloc(tic_key, tic_key_size, "tic cache key");
+    }
+    memcpy(tic_key + tic_key_len, data, len);
+    tic_key_len += len;
+}
+
+static void
+tic_key_add_string(const char *string)
+{
+    /* NULL and "" must not give the same key */
+    if (string)
+	tic_key_add(string, strlen(string) + 1);
+    else
+	tic_key_add("\377", 1);
+}
+
+/* Build the key describing the current state of the axis and compare it
+ * to the one of the cached tics.  Returns TRUE if the cached tics can be
+ * replayed.  Otherwise the cache entry is emptied and prepared to record
+ * the tics generated by this call.
+ */
+static TBOOLEAN
+tic_cache_lookup(AXIS_INDEX axis)
+{
+    struct tic_cache *cache = &tic_cache[axis];
+    AXIS *this = &axis_array[axis];
+    struct ticdef *def = &this->ticdef;
+    struct ticmark *mark;
+    struct {
+	double min, max, base;
+	double start, incr, end;
+	double data_min, data_max;
+	double ticstep, mtic_freq, miniticscale;
+	double polar_min, polar_max, polar_base, x_min, x_max;
+	int log, datatype, type, mix, rangelimited;
+	int timelevel, minitics, polar, polar_log, polar_autoscale, polar_ticmode;
+	int term_xmax, term_flags, encoding;
+	struct termentry *term;
+	struct ticmark *user;
+    } numbers;
+
+    /* memset so that the structure padding compares equal, too */
+    memset(&numbers, 0, sizeof(numbers));
+    numbers.min = this->min;
+    numbers.max = this->max;
+    numbers.base = this->base;
+    numbers.log = this->log;
+    numbers.datatype = this->datatype;
+    numbers.type = def->type;
+    numbers.start = def->def.series.start;
+    numbers.incr = def->def.series.incr;
+    numbers.end = def->def.series.end;
+    numbers.mix = def->def.mix;
+    numbers.user = def->def.user;
+    numbers.rangelimited = def->rangelimited;
+    if (def->rangelimited) {
+	numbers.data_min = this->data_min;
+	numbers.data_max = this->data_max;
+    }
+    numbers.ticstep = ticstep[axis];
+    numbers.timelevel = timelevel[axis];
+    numbers.minitics = this->minitics;
+    numbers.mtic_freq = this->mtic_freq;
+    numbers.miniticscale = this->miniticscale;
+    numbers.polar = polar;
+    if (polar) {
+	numbers.polar_min = R_AXIS.min;
+	numbers.polar_max = R_AXIS.max;
+	numbers.polar_base = R_AXIS.base;
+	numbers.polar_log = R_AXIS.log;
+	numbers.polar_autoscale = R_AXIS.autoscale;
+	numbers.polar_ticmode = R_AXIS.ticmode;
+	numbers.x_min = X_AXIS.min;
+	numbers.x_max = X_AXIS.max;
+    }
+    numbers.term = term;
+    numbers.term_xmax = term->xmax;
+    numbers.term_flags = term->flags;
+    numbers.encoding = encoding;
+
+    tic_key_len = 0;
+    tic_key_add(&numbers, sizeof(numbers));
+    tic_key_add_string(axis < PARALLEL_AXES ? ticfmt[axis] : this->formatstring);
+    tic_key_add_string(decimalsign);
+    tic_key_add_string(numeric_locale);
+    tic_key_add_string(current_locale);
+    tic_key_add_string(degree_sign);
+    /* The list of user tics is edited in place, so the pointer to its
+     * head is not enough to identify its contents */
+    for (mark = def->def.user; mark; mark = mark->next) {
+	tic_key_add(&mark->position, sizeof(mark->position));
+	tic_key_add(&mark->level, sizeof(mark->level));
+	tic_key_add_string(mark->label);
+    }
+
+    /* The list is only valid once recording has finished, so a callback
+     * that calls gen_tics for the same axis again never replays a half
+     * recorded list.  Such a nested call, like one after an int_error
+     * aborted the last recording, simply starts a new one. */
+    if (cache->valid && cache->keylen == tic_key_len
+    &&  !memcmp(cache->key, tic_key, tic_key_len))
+	return TRUE;
+
+    cache->valid = FALSE;
+    cache->key = gp_realloc(cache->key, tic_key_len, "tic cache key");
+    memcpy(cache->key, tic_key, tic_key_len);
+    cache->keylen = tic_key_len;
+    cache->n_tics = 0;
+    cache->labels_used = 0;
+    cache->recording = TRUE;
+    return FALSE;
+}
+
+/* Append one tic to the list being recorded for this axis */
+static void
+tic_cache_store(
+    AXIS_INDEX axis,
+    double place,
+    char *label,
+    int level,
+    int grid,
+    TBOOLEAN userlist)
+{
+    struct tic_cache *cache = &tic_cache[axis];
+    struct tic_record *tic;
+
+    if (!cache->recording)
+	return;
+    if (cache->n_tics >= cache->max_tics) {
+	cache->max_tics = 2 * cache->max_tics + 16;
+	cache->tics = gp_realloc(cache->tics,
+			cache->max_tics * sizeof(struct tic_record), "tic cache");
+    }
+    tic = &cache->tics[cache->n_tics++];
+    tic->place = place;
+    tic->level = level;
+    tic->grid = grid;
+    tic->userlist = userlist;
+    tic->label = -1;
+    if (label) {
+	size_t len = strlen(label) + 1;
+	if (cache->labels_used + len > cache->labels_size) {
+	    cache->labels_size = 2 * (cache->labels_used + len) + 256;
+	    cache->labels = gp_realloc(cache->labels, cache->labels_size,
+					"tic cache labels");
+	}
+	memcpy(cache->labels + cache->labels_used, label, len);
+	tic->label = cache->labels_used;
+	cache->labels_used += len;
+    }
+}
+
+/* Feed the recorded tics of this axis to the callback */
+static void
+tic_cache_replay(
+    AXIS_INDEX axis,
+    tic_callback callback,
+    struct lp_style_type lgrd,
+    struct lp_style_type mgrd)
+{
+    struct tic_cache *cache = &tic_cache[axis];
+    struct lp_style_type nogrd = lgrd;
+    int i;
+
+    nogrd.l_type = LT_NODRAW;
+    for (i = 0; i < cache->n_tics; i++) {
+	struct tic_record *tic = &cache->tics[i];
+	(*callback) (axis, tic->place,
+		(tic->label < 0) ? NULL : cache->labels + tic->label,
+		tic->level,
+		(tic->grid == TIC_GRID_MINOR) ? mgrd
+		    : (tic->grid == TIC_GRID_NONE) ? nogrd : lgrd,
+		tic->userlist ? axis_array[axis].ticdef.def.user : NULL);
+    }
+}
+/* }}} */
+
 /* {{{  gen_tics */
 /* uses global arrays ticstep[], ticfmt[], axis_array[],
  * we use any of GRID_X/Y/X2/Y2 and  _MX/_MX2/etc - caller is expected
@@ -898,6 +1119,30 @@ setup_tics(AXIS_INDEX axis, int max)
  */
 void
 gen_tics(AXIS_INDEX axis, tic_callback callback)
+{
+    struct lp_style_type lgrd = grid_lp;
+    struct lp_style_type mgrd = mgrid_lp;
+
+    if (! axis_array[axis].gridmajor)
+	lgrd.l_type = LT_NODRAW;
+    if (! axis_array[axis].gridminor)
+	mgrd.l_type = LT_NODRAW;
+
+    if (tic_cache_lookup(axis)) {
+	tic_cache_replay(axis, callback, lgrd, mgrd);
+	return;
+    }
+    generate_tics(axis, callback);
+    /* generate_tics stops the recording if it issued a warning, so that
+     * the warning is not lost on the next pass */
+    tic_cache[axis].valid = tic_cache[axis].recording;
+    tic_cache[axis].recording = FALSE;
+}
+
+/* Place the tics of an axis, format their labels, and hand them to the
+ * callback while recording them in tic_cache[axis] */
+static void
+generate_tics(AXIS_INDEX axis, tic_callback callback)
 {
     struct ticdef *def = &axis_array[axis].ticdef;
     int minitics = axis_array[axis].minitics; /* off/default/auto/explicit */
@@ -978,6 +1223,8 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 
 	    /* use NULL instead of label for minor tics with level 1,
 	     * however, allow labels for minor tics with levels > 1 */
+	    tic_cache_store(axis, internal, (mark->level==1)?NULL:ticlabel,
+			mark->level, (mark->level>0)?TIC_GRID_MINOR:TIC_GRID_MAJOR, FALSE);
 	    (*callback) (axis, internal,
 	    		(mark->level==1)?NULL:ticlabel,
 	    		mark->level,
@@ -987,6 +1234,8 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 	    if (axis == POLAR_AXIS && (R_AXIS.ticmode & TICS_MIRROR)) {
 		int save_gridline = lgrd.l_type;
 		lgrd.l_type = LT_NODRAW;
+		tic_cache_store(axis, -internal, (mark->level==1)?NULL:ticlabel,
+			mark->level, (mark->level>0)?TIC_GRID_MINOR:TIC_GRID_NONE, FALSE);
 		(*callback) (axis, -internal,
 			(mark->level==1)?NULL:ticlabel,
 			mark->level,
@@ -1177,6 +1426,7 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 
 	/* This protects against user error, not precision errors */
 	if ( (internal_max-internal_min)/step > term->xmax) {
+	    tic_cache[axis].recording = FALSE;
 	    int_warn(NO_CARET,"Too many axis ticks requested (>%.0g)",
 		(internal_max-internal_min)/step);
 	    return;
@@ -1193,6 +1443,7 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 	    if (fabs(vol_this_tic - vol_previous_tic) < (step/4.)) {
 		step = end - start;
 		nsteps = 2;
+		tic_cache[axis].recording = FALSE;
 		int_warn(NO_CARET, "tick interval too small for machine precision");
 		break;
 	    }
@@ -1226,6 +1477,8 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 			int d = (long) floor(user + 0.5) % 7;
 			if (d < 0)
 			    d += 7;
+			tic_cache_store(axis, internal, abbrev_day_names[d], 0,
+					TIC_GRID_MAJOR, TRUE);
 			(*callback) (axis, internal, abbrev_day_names[d], 0, lgrd,
 					def->def.user);
 			break;
@@ -1234,6 +1487,8 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 			int m = (long) floor(user - 1) % 12;
 			if (m < 0)
 			    m += 12;
+			tic_cache_store(axis, internal, abbrev_month_names[m], 0,
+					TIC_GRID_MAJOR, TRUE);
 			(*callback) (axis, internal, abbrev_month_names[m], 0, lgrd,
 					def->def.user);
 			break;
@@ -1270,12 +1525,14 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 			&&  !inrange(internal,axis_array[axis].data_min,axis_array[axis].data_max))
 			    continue;
 
+			tic_cache_store(axis, internal, label, 0, TIC_GRID_MAJOR, TRUE);
 			(*callback) (axis, internal, label, 0, lgrd, def->def.user);
 
 	 		/* Polar axis tics are mirrored across the origin */
 			if (axis == POLAR_AXIS && (R_AXIS.ticmode & TICS_MIRROR)) {
 			    int save_gridline = lgrd.l_type;
 			    lgrd.l_type = LT_NODRAW;
+			    tic_cache_store(axis, -internal, label, 0, TIC_GRID_NONE, TRUE);
 			    (*callback) (axis, -internal, label, 0, lgrd, def->def.user);
 			    lgrd.l_type = save_gridline;
 			}
@@ -1299,8 +1556,10 @@ gen_tics(AXIS_INDEX axis, tic_callback callback)
 		    temptic = mtic;
 		    if (polar) temptic += R_AXIS.min;
 		    if (inrange(temptic, internal_min, internal_max)
-			&& inrange(temptic, start - step * SIGNIF, end + step * SIGNIF))
+			&& inrange(temptic, start - step * SIGNIF, end + step * SIGNIF)) {
+			tic_cache_store(axis, mtic, NULL, 1, TIC_GRID_MINOR, FALSE);
 			(*callback) (axis, mtic, NULL, 1, mgrd, NULL);
+		    }
 		}
 		/* }}} */
 	    }
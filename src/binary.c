@@ -123,11 +123,14 @@ fread_matrix(
 
 	current_row++;
 	if (current_row >= num_rows) {	/* We've got to make a bigger rowsize */
+	    /* Grow geometrically, so that reading n rows costs O(n) */
+	    int add_rows = (num_rows > ADD_ROWS) ? num_rows : ADD_ROWS;
+
 	    temp_array = extend_matrix(m, 0, num_rows - 1, 0, num_cols - 1,
-				       num_rows + ADD_ROWS - 1, num_cols - 1);
-	    rt = extend_vector(rt, 0, num_rows + ADD_ROWS - 1);
+				       num_rows + add_rows - 1, num_cols - 1);
+	    rt = extend_vector(rt, 0, num_rows + add_rows - 1);
 
-	    num_rows += ADD_ROWS;
+	    num_rows += add_rows;
 	    m = temp_array;
 	}
     }
@@ -195,6 +198,198 @@ fwrite_matrix(
     return (TRUE);
 }
 
+/*================ Version 1 binary matrix format =====================
+  See binary.h for the layout.  The writer always uses the byte order of
+  the machine it runs on; the reader swaps if necessary.
+*/
+
+static TBOOLEAN
+gpbin_host_is_big_endian()
+{
+    union { short s; char c[sizeof(short)]; } u;
+
+    u.s = 1;
+    return (u.c[0] == 0);
+}
+
+static void
+gpbin_swap(unsigned char *p, size_t size, size_t count)
+{
+    size_t i, j;
+
+    for (; count--; p += size)
+	for (i = 0, j = size - 1; i < j; i++, j--) {
+	    unsigned char temp = p[i];
+
+	    p[i] = p[j];
+	    p[j] = temp;
+	}
+}
+
+static void
+gpbin_put_u64(unsigned char *p, size_t val, TBOOLEAN big_endian)
+{
+    int i;
+
+    for (i = 0; i < 8; i++, val >>= 8)
+	p[big_endian ? 7 - i : i] = val & 0xff;
+}
+
+static TBOOLEAN
+gpbin_get_u64(const unsigned char *p, TBOOLEAN big_endian, size_t *val)
+{
+    size_t v = 0;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+	if (v > ((size_t) -1) >> 8)
+	    return FALSE;
+	v = (v << 8) | p[big_endian ? i : 7 - i];
+    }
+    *val = v;
+    return TRUE;
+}
+
+size_t
+gpbin_element_size(gpbin_type type)
+{
+    switch (type) {
+    case GPBIN_FLOAT32:	return 4;
+    case GPBIN_FLOAT64:	return 8;
+    case GPBIN_INT16:	return 2;
+    case GPBIN_UINT8:	return 1;
+    }
+    return 0;
+}
+
+/* Decode the first GPBIN_HEADER_SIZE bytes of a file.  Returns FALSE
+ * if they are not a version 1 header (e.g. an old-style float matrix).
+ */
+int
+gpbin_decode_header(const unsigned char *buf, gpbin_header *header)
+{
+    if (memcmp(buf, GPBIN_MAGIC, 4) || buf[4] != GPBIN_VERSION || buf[7] != 0
+	|| buf[6] > 1 || !gpbin_element_size((gpbin_type) buf[5]))
+	return FALSE;
+
+    header->version = buf[4];
+    header->type = (gpbin_type) buf[5];
+    header->big_endian = buf[6];
+    if (!gpbin_get_u64(buf + 8, header->big_endian, &header->ncols)
+	|| !gpbin_get_u64(buf + 16, header->big_endian, &header->nrows)
+	|| !gpbin_get_u64(buf + 24, header->big_endian, &header->header_size)
+	|| header->header_size < GPBIN_HEADER_SIZE)
+	return FALSE;
+    return TRUE;
+}
+
+/* Write a matrix of nrows x ncols elements of the given type, stored
+ * contiguously one row after another.  If row_title or column_title is
+ * NULL the row or column index is used as the coordinate.
+ */
+int
+fwrite_binary_matrix(
+    FILE *fout,
+    gpbin_type type,
+    const void *data,
+    size_t nrows, size_t ncols,
+    const double *row_title,
+    const double *column_title)
+{
+    unsigned char header[GPBIN_HEADER_SIZE];
+    TBOOLEAN big_endian = gpbin_host_is_big_endian();
+    size_t i;
+
+    if (!gpbin_element_size(type))
+	return FALSE;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, GPBIN_MAGIC, 4);
+    header[4] = GPBIN_VERSION;
+    header[5] = type;
+    header[6] = big_endian;
+    gpbin_put_u64(header + 8, ncols, big_endian);
+    gpbin_put_u64(header + 16, nrows, big_endian);
+    gpbin_put_u64(header + 24, GPBIN_HEADER_SIZE, big_endian);
+    if (fwrite(header, sizeof(header), 1, fout) != 1)
+	return FALSE;
+
+    for (i = 0; i < ncols; i++) {
+	double coord = column_title ? column_title[i] : (double) i;
+
+	if (fwrite(&coord, sizeof(coord), 1, fout) != 1)
+	    return FALSE;
+    }
+    for (i = 0; i < nrows; i++) {
+	double coord = row_title ? row_title[i] : (double) i;
+
+	if (fwrite(&coord, sizeof(coord), 1, fout) != 1)
+	    return FALSE;
+    }
+    if (nrows && ncols
+	&& fwrite(data, gpbin_element_size(type) * ncols, nrows, fout) != nrows)
+	return FALSE;
+
+    return TRUE;
+}
+
+/* Read a version 1 matrix.  The elements come back in host byte order in
+ * a single allocation of nrows*ncols elements, the coordinates in two
+ * double vectors; all three are released with free().  Returns NULL,
+ * with the stream back where it started, if the file is not in this
+ * format, and NULL if it is truncated.
+ */
+void *
+fread_binary_matrix(
+    FILE *fin,
+    gpbin_header *header,
+    double **row_title,
+    double **column_title)
+{
+    unsigned char buf[GPBIN_HEADER_SIZE];
+    long where = ftell(fin);
+    size_t esize, count;
+    TBOOLEAN swap;
+    double *rt = NULL, *ct = NULL;
+    unsigned char *data = NULL;
+
+    if (fread(buf, sizeof(buf), 1, fin) != 1 || !gpbin_decode_header(buf, header)) {
+	if (where >= 0)
+	    fseek(fin, where, SEEK_SET);
+	return NULL;
+    }
+    if (header->header_size > GPBIN_HEADER_SIZE
+	&& fseek(fin, (long) (header->header_size - GPBIN_HEADER_SIZE), SEEK_CUR))
+	return NULL;
+
+    esize = gpbin_element_size(header->type);
+    if (header->ncols && header->nrows > ((size_t) -1) / header->ncols / esize)
+	return NULL;
+    count = header->nrows * header->ncols;
+    swap = (header->big_endian != gpbin_host_is_big_endian());
+
+    ct = gp_alloc((header->ncols + 1) * sizeof(double), "matrix column coordinates");
+    rt = gp_alloc((header->nrows + 1) * sizeof(double), "matrix row coordinates");
+    data = gp_alloc(count * esize + 1, "binary matrix");
+    if (fread(ct, sizeof(double), header->ncols, fin) != header->ncols
+	|| fread(rt, sizeof(double), header->nrows, fin) != header->nrows
+	|| fread(data, esize, count, fin) != count) {
+	free(ct);
+	free(rt);
+	free(data);
+	return NULL;
+    }
+    if (swap) {
+	gpbin_swap((unsigned char *) ct, sizeof(double), header->ncols);
+	gpbin_swap((unsigned char *) rt, sizeof(double), header->nrows);
+	gpbin_swap(data, esize, count);
+    }
+
+    *row_title = rt;
+    *column_title = ct;
+    return data;
+}
+
 /*===================== Support routines ==============================*/
 
 /* ******************************* VECTOR *******************************
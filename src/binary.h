@@ -40,6 +40,48 @@
 #include "syscfg.h"
 #include "stdfn.h"
 
+/* Version 1 of the gnuplot binary matrix format.  Unlike the original
+ * float-only format (column count, then rows each prefixed with their
+ * coordinate) it stores the dimensions, element type and byte order in
+ * a header, keeps coordinates in double precision and lays the data out
+ * as one contiguous block.  All multi-byte fields use the byte order
+ * given in the header.
+ *
+ *	offset	bytes		contents
+ *	     0	4		magic "GPBM"
+ *	     4	1		format version (GPBIN_VERSION)
+ *	     5	1		element type (gpbin_type)
+ *	     6	1		byte order: 0 = little endian, 1 = big endian
+ *	     7	1		reserved, 0
+ *	     8	8		number of columns, unsigned
+ *	    16	8		number of rows, unsigned
+ *	    24	8		header length, i.e. offset of the coordinates
+ *	header	8*ncols		column coordinates, float64
+ *		8*nrows		row coordinates, float64
+ *		nrows*ncols	elements, one row after another
+ *
+ * Read as a float, the magic number is far larger than any column count
+ * of the old format, so the first four bytes tell the two apart.
+ */
+#define GPBIN_MAGIC "GPBM"
+#define GPBIN_VERSION 1
+#define GPBIN_HEADER_SIZE 32
+
+typedef enum gpbin_type {
+    GPBIN_FLOAT32 = 1,
+    GPBIN_FLOAT64,
+    GPBIN_INT16,
+    GPBIN_UINT8
+} gpbin_type;
+
+typedef struct gpbin_header {
+    int version;
+    gpbin_type type;
+    TBOOLEAN big_endian;
+    size_t ncols, nrows;
+    size_t header_size;
+} gpbin_header;
+
 /* Routines for interfacing with command.c */
 float GPFAR *alloc_vector __PROTO(( int nl, int nh));
 float GPFAR *extend_vector __PROTO((float GPFAR *vec, int old_nl, int new_nh));
@@ -54,5 +96,9 @@ int fread_matrix __PROTO((FILE *fin, float GPFAR * GPFAR * GPFAR *ret_matrix, in
 int fwrite_matrix __PROTO((FILE *fout, float GPFAR * GPFAR *m, int nrl, int nrh, int ncl, int nch, float GPFAR *row_title, float GPFAR *column_title));
 float GPFAR * GPFAR *convert_matrix __PROTO((float GPFAR *a, int nrl, int nrh, int ncl, int nch));
 void free_convert_matrix __PROTO((float GPFAR* GPFAR *b, int nrl));
+size_t gpbin_element_size __PROTO((gpbin_type type));
+int gpbin_decode_header __PROTO((const unsigned char *buf, gpbin_header *header));
+int fwrite_binary_matrix __PROTO((FILE *fout, gpbin_type type, const void *data, size_t nrows, size_t ncols, const double *row_title, const double *column_title));
+void *fread_binary_matrix __PROTO((FILE *fin, gpbin_header *header, double **row_title, double **column_title));
 
 #endif /* GNUPLOT_BINARY_H */
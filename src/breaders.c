@@ -47,6 +47,7 @@ static char *RCSid() { return RCSid("$Id: breaders.c,v 1.12 2012/06/08 17:33:41
 #include "breaders.h"
 #include "datafile.h"
 #include "alloc.h"
+#include "gp_time.h"
 #include "misc.h"
 
 /*
@@ -258,6 +259,433 @@ edf_filetype_function(void)
 
 }
 
+/*
+ * Reader for Apache Arrow IPC files and streams (".arrow", ".feather").
+ *
+ * The file holds a schema followed by record batches, each a contiguous
+ * run of rows stored column by column.  The metadata are flatbuffers;
+ * only the little needed to find the type of each column and where its
+ * values lie in each batch is decoded here.  The values themselves are
+ * left in the file, to be decoded (from a memory map if possible) by
+ * df_readbinary() as the plot reads them.
+ *
+ * Supported are columns of integer, floating point, date, time, timestamp
+ * and duration type.  Dates and timestamps are converted to gnuplot's
+ * time representation.  Other columns keep their place in the column
+ * numbering but read as undefined, as do null values.  Compressed and
+ * dictionary encoded columns are not supported.
+ */
+
+/* Arrow metadata type numbers */
+enum arrow_ipc_message {
+    ARROW_SCHEMA = 1, ARROW_DICTIONARY_BATCH = 2, ARROW_RECORD_BATCH = 3
+};
+enum arrow_ipc_type {
+    ARROW_NULL = 1, ARROW_INT, ARROW_FLOAT, ARROW_BINARY, ARROW_UTF8,
+    ARROW_BOOL, ARROW_DECIMAL, ARROW_DATE, ARROW_TIME, ARROW_TIMESTAMP,
+    ARROW_INTERVAL, ARROW_LIST, ARROW_STRUCT, ARROW_UNION,
+    ARROW_FIXED_BINARY, ARROW_FIXED_LIST, ARROW_MAP, ARROW_DURATION,
+    ARROW_LARGE_BINARY, ARROW_LARGE_UTF8, ARROW_LARGE_LIST,
+    ARROW_RUN_END_ENCODED
+};
+
+/* The flatbuffer being decoded: the metadata of one message */
+static unsigned char *fb_buf = NULL;
+static size_t fb_len = 0;
+
+/* The file being scanned and the buffer and node counts and value size
+ * of each column.  They are released by arrow_reset(), also when an
+ * error interrupts the scan. */
+static FILE *arrow_fp = NULL;
+static int *field_buffers = NULL, *field_nodes = NULL;
+static int *value_size = NULL;
+
+static void
+fb_check(size_t pos, size_t n)
+{
+    if (pos > fb_len || n > fb_len - pos)
+	int_error(NO_CARET, "Damaged Arrow metadata in \"%s\"", df_filename);
+}
+
+/* Little-endian integer of n bytes at pos */
+static long long
+fb_int(size_t pos, int n)
+{
+    unsigned long long u = 0;
+    int i;
+
+    fb_check(pos, n);
+    for (i = n - 1; i >= 0; i--)
+	u = (u << 8) | fb_buf[pos + i];
+    if (n < 8 && (u >> (8*n - 1)) & 1)		/* sign extend */
+	u |= ~0ULL << (8*n);
+    return (long long) u;
+}
+
+/* Follow the offset stored at pos */
+static size_t
+fb_deref(size_t pos)
+{
+    size_t target = pos + (size_t)(fb_int(pos, 4) & 0xffffffffL);
+
+    fb_check(target, 4);
+    return target;
+}
+
+/* Position of field number n of the table at pos, 0 if it is absent */
+static size_t
+fb_field(size_t table, int n)
+{
+    size_t vtable = table - (size_t) fb_int(table, 4);
+    int vsize = fb_int(vtable, 2) & 0xffff;
+    int offset;
+
+    if (4 + 2*n + 2 > vsize)
+	return 0;
+    offset = fb_int(vtable + 4 + 2*n, 2) & 0xffff;
+    if (!offset)
+	return 0;
+    fb_check(table + offset, 1);
+    return table + offset;
+}
+
+/* Scalar field n of a table, or its default value */
+static long long
+fb_scalar(size_t table, int n, int size, long long dflt)
+{
+    size_t pos = fb_field(table, n);
+    return pos ? fb_int(pos, size) : dflt;
+}
+
+/* Table referred to by field n of a table, 0 if absent */
+static size_t
+fb_table(size_t table, int n)
+{
+    size_t pos = fb_field(table, n);
+    return pos ? fb_deref(pos) : 0;
+}
+
+/* Vector in field n of a table: the position of its first element, and
+ * the number of elements of the given size.  0 if absent. */
+static size_t
+fb_vector(size_t table, int n, int size, long *count)
+{
+    size_t pos = fb_field(table, n);
+
+    *count = 0;
+    if (!pos)
+	return 0;
+    pos = fb_deref(pos);
+    *count = fb_int(pos, 4) & 0xffffffffL;
+    fb_check(pos + 4, (size_t)*count * size);
+    return pos + 4;
+}
+
+/* Number of buffers and of field nodes that a field and its children
+ * take up in a record batch. */
+static void
+arrow_field_size(size_t field, int version, int *buffers, int *nodes)
+{
+    size_t children;
+    long nchildren, i;
+    int type = fb_scalar(field, 2, 1, 0);
+
+    switch (type) {
+    case ARROW_NULL:
+    case ARROW_RUN_END_ENCODED:
+	break;
+    case ARROW_STRUCT:
+    case ARROW_FIXED_LIST:
+	*buffers += 1;
+	break;
+    case ARROW_BINARY:
+    case ARROW_UTF8:
+    case ARROW_LARGE_BINARY:
+    case ARROW_LARGE_UTF8:
+	*buffers += 3;
+	break;
+    case ARROW_UNION:
+	/* type ids, offsets if dense, and a validity bitmap before V5 */
+	{
+	    size_t type = fb_table(field, 3);
+	    *buffers += 1 + (type && fb_scalar(type, 0, 2, 0) == 1)
+			  + (version < 4);
+	}
+	break;
+    default:
+	if (type < ARROW_INT || type > ARROW_LARGE_LIST)
+	    int_error(NO_CARET, "Arrow column type %d is not supported", type);
+	*buffers += 2;
+	break;
+    }
+    *nodes += 1;
+
+    children = fb_vector(field, 5, 4, &nchildren);
+    for (i = 0; i < nchildren; i++)
+	arrow_field_size(fb_deref(children + 4*i), version, buffers, nodes);
+}
+
+/* Set the binary type of column col from its schema field.  Returns
+ * the size of one value, or 0 if the values cannot be read. */
+static int
+arrow_column_type(size_t field, int col, double *scale, double *offset)
+{
+    size_t type = fb_table(field, 3);
+    int unit = type ? fb_scalar(type, 0, 2, 0) : 0;
+    static const double unit_scale[] = { 1.0, 1e-3, 1e-6, 1e-9 };
+
+    *scale = 1.0;
+    *offset = 0.0;
+    if (fb_field(field, 4))		/* dictionary encoded */
+	return 0;
+
+    switch (fb_scalar(field, 2, 1, 0)) {
+    case ARROW_INT:
+	{
+	    int bytes = fb_scalar(type, 0, 4, 0) / 8;
+	    TBOOLEAN is_signed = fb_scalar(type, 1, 1, 0);
+	    df_data_type dtype = is_signed ? SIGNED_TEST(bytes) : UNSIGNED_TEST(bytes);
+	    if (dtype == DF_BAD_TYPE)
+		return 0;
+	    df_set_read_type(col, dtype);
+	    return bytes;
+	}
+    case ARROW_FLOAT:
+	/* HALF is not supported */
+	if (unit == 0)
+	    return 0;
+	df_set_read_type(col, FLOAT_TEST(unit == 1 ? 4 : 8));
+	return (unit == 1) ? 4 : 8;
+    case ARROW_DATE:
+	/* days in 32 bits, or milliseconds in 64 bits */
+	df_set_read_type(col, SIGNED_TEST(unit == 0 ? 4 : 8));
+	*scale = (unit == 0) ? 86400.0 : 1e-3;
+	*offset = -SEC_OFFS_SYS;
+	return (unit == 0) ? 4 : 8;
+    case ARROW_TIMESTAMP:
+	*offset = -SEC_OFFS_SYS;
+	/* FALLTHROUGH */
+    case ARROW_DURATION:
+	if (unit > 3)
+	    return 0;
+	df_set_read_type(col, SIGNED_TEST(8));
+	*scale = unit_scale[unit];
+	return 8;
+    case ARROW_TIME:
+	{
+	    int bytes = fb_scalar(type, 1, 4, 32) / 8;
+	    if (unit > 3 || (bytes != 4 && bytes != 8))
+		return 0;
+	    df_set_read_type(col, SIGNED_TEST(bytes));
+	    *scale = unit_scale[unit];
+	    return bytes;
+	}
+    default:
+	return 0;
+    }
+}
+
+void
+arrow_reset(void)
+{
+    if (arrow_fp)
+	fclose(arrow_fp);
+    arrow_fp = NULL;
+    free(fb_buf);
+    fb_buf = NULL;
+    free(field_buffers);
+    free(field_nodes);
+    free(value_size);
+    field_buffers = field_nodes = value_size = NULL;
+}
+
+void
+arrow_filetype_function(void)
+{
+    FILE *fp;
+    df_column_layout *layout;
+    unsigned char prefix[8];
+    long pos = 0;
+    int col;
+
+    arrow_reset();
+    fp = arrow_fp = loadpath_fopen(df_filename, "rb");
+    if (!fp)
+	os_error(NO_CARET, "Can't open data file \"%s\"", df_filename);
+
+    df_free_columnar();
+    layout = df_columnar = gp_alloc(sizeof(df_column_layout), "arrow layout");
+    memset(layout, 0, sizeof(df_column_layout));
+
+    /* The file format starts with a magic number, the stream format
+     * directly with the schema message. */
+    if (fread(prefix, 1, 8, fp) != 8)
+	prefix[0] = 0;
+    if (!memcmp(prefix, "ARROW1", 6))
+	pos = 8;
+    else if (memcmp(prefix, "\377\377\377\377", 4))
+	int_error(NO_CARET, "\"%s\" is not an Arrow file", df_filename);
+
+    for (;;) {
+	unsigned char word[4];
+	unsigned long length;
+	size_t message, header;
+	long body;
+	long long body_length;
+	int version;
+
+	/* Each message is an optional continuation marker 0xFFFFFFFF,
+	 * the length of its metadata, the metadata and then the body. */
+	if (fseek(fp, pos, SEEK_SET) || fread(word, 1, 4, fp) != 4)
+	    break;
+	pos += 4;
+	length = word[0] | (word[1] << 8) | ((unsigned long)word[2] << 16)
+		| ((unsigned long)word[3] << 24);
+	if (length == 0xffffffffUL) {
+	    if (fread(word, 1, 4, fp) != 4)
+		break;
+	    pos += 4;
+	    length = word[0] | (word[1] << 8) | ((unsigned long)word[2] << 16)
+		    | ((unsigned long)word[3] << 24);
+	}
+	if (length == 0 || length > 0x7fffffffUL)	/* end of stream */
+	    break;
+
+	fb_buf = gp_realloc(fb_buf, length, "arrow metadata");
+	fb_len = length;
+	if (fread(fb_buf, 1, length, fp) != length)
+	    int_error(NO_CARET, "Arrow file \"%s\" is truncated", df_filename);
+	body = pos + length;
+
+	message = fb_deref(0);
+	version = fb_scalar(message, 0, 2, 0);
+	header = fb_table(message, 2);
+	body_length = fb_scalar(message, 3, 8, 0);
+	if (body_length < 0)
+	    int_error(NO_CARET, "Damaged Arrow metadata in \"%s\"", df_filename);
+
+	switch (fb_scalar(message, 1, 1, 0)) {
+	case ARROW_SCHEMA:
+	    {
+		long nfields;
+		size_t fields = fb_vector(header, 1, 4, &nfields);
+
+		if (layout->ncols)
+		    int_error(NO_CARET, "Arrow file \"%s\" has more than one schema", df_filename);
+		if (nfields <= 0)
+		    int_error(NO_CARET, "Arrow file \"%s\" has no columns", df_filename);
+		layout->names = gp_alloc(nfields * sizeof(char *), "arrow names");
+		for (col = 0; col < nfields; col++)
+		    layout->names[col] = NULL;
+		layout->ncols = nfields;
+		layout->scale = gp_alloc(nfields * sizeof(double), "arrow scale");
+		layout->offset = gp_alloc(nfields * sizeof(double), "arrow offset");
+		field_buffers = gp_alloc(nfields * sizeof(int), "arrow fields");
+		field_nodes = gp_alloc(nfields * sizeof(int), "arrow fields");
+		value_size = gp_alloc(nfields * sizeof(int), "arrow fields");
+
+		df_extend_binary_columns(nfields);
+		for (col = 0; col < nfields; col++) {
+		    size_t field = fb_deref(fields + 4*col);
+		    long namelen;
+		    size_t name = fb_field(field, 0);
+
+		    if (name) {
+			name = fb_deref(name);
+			namelen = fb_int(name, 4) & 0xffffffffL;
+			fb_check(name + 4, namelen);
+			layout->names[col] = gp_alloc(namelen + 1, "arrow name");
+			memcpy(layout->names[col], fb_buf + name + 4, namelen);
+			layout->names[col][namelen] = '\0';
+		    }
+		    field_buffers[col] = field_nodes[col] = 0;
+		    arrow_field_size(field, version, &field_buffers[col], &field_nodes[col]);
+		    df_set_skip_before(col+1, 0);
+		    df_set_read_type(col+1, DF_UCHAR);
+		    value_size[col] = arrow_column_type(field, col+1,
+					&layout->scale[col], &layout->offset[col]);
+		}
+		df_set_skip_after(nfields, 0);
+		df_bin_file_endianess = (fb_scalar(header, 0, 2, 0) == 1)
+				      ? DF_BIG_ENDIAN : DF_LITTLE_ENDIAN;
+		break;
+	    }
+
+	case ARROW_RECORD_BATCH:
+	    {
+		struct df_column_batch *batch;
+		long nnodes, nbuffers;
+		size_t nodes = fb_vector(header, 1, 16, &nnodes);
+		size_t buffers = fb_vector(header, 2, 16, &nbuffers);
+		int node = 0, buffer = 0;
+
+		if (!layout->ncols)
+		    int_error(NO_CARET, "Arrow file \"%s\" has no schema", df_filename);
+		if (fb_field(header, 3))
+		    int_error(NO_CARET, "Compressed Arrow files are not supported");
+
+		layout->batch = gp_realloc(layout->batch,
+				(layout->nbatches + 1) * sizeof(*batch), "arrow batch");
+		batch = &layout->batch[layout->nbatches++];
+		batch->values = batch->validity = NULL;
+		batch->rows = fb_scalar(header, 0, 8, 0);
+		batch->values = gp_alloc(layout->ncols * sizeof(long), "arrow batch");
+		batch->validity = gp_alloc(layout->ncols * sizeof(long), "arrow batch");
+		if (batch->rows < 0)
+		    int_error(NO_CARET, "Damaged Arrow metadata in \"%s\"", df_filename);
+
+		for (col = 0; col < layout->ncols; col++) {
+		    size_t b = buffers + 16 * buffer;
+		    long long null_count;
+
+		    batch->values[col] = batch->validity[col] = -1;
+		    if (node + field_nodes[col] > nnodes
+		    ||  buffer + field_buffers[col] > nbuffers)
+			int_error(NO_CARET, "Damaged Arrow metadata in \"%s\"", df_filename);
+		    null_count = fb_int(nodes + 16 * node + 8, 8);
+
+		    /* buffer b is the null bitmap, b+1 the values */
+		    if (value_size[col]) {
+			long long start = fb_int(b + 16, 8);
+			long long length = fb_int(b + 24, 8);
+			if (start < 0 || length < batch->rows * value_size[col]
+			||  start + length > body_length)
+			    int_error(NO_CARET, "Damaged Arrow data in \"%s\"", df_filename);
+			batch->values[col] = body + start;
+
+			start = fb_int(b, 8);
+			length = fb_int(b + 8, 8);
+			if (null_count > 0 && length > 0) {
+			    if (start < 0 || length < (batch->rows + 7) / 8
+			    ||  start + length > body_length)
+				int_error(NO_CARET, "Damaged Arrow data in \"%s\"", df_filename);
+			    batch->validity[col] = body + start;
+			}
+		    }
+		    node += field_nodes[col];
+		    buffer += field_buffers[col];
+		}
+		break;
+	    }
+
+	default:
+	    /* Dictionary batches and anything else are skipped */
+	    break;
+	}
+
+	pos = body + body_length;
+    }
+
+    arrow_reset();
+
+    if (!layout->ncols)
+	int_error(NO_CARET, "Arrow file \"%s\" has no schema", df_filename);
+
+    df_matrix_file = FALSE;
+    df_binary_file = TRUE;
+    df_bin_record[0].scan_skip[0] = 0;
+}
+
 /*
  *	Use libgd for input of binary images in PNG GIF JPEG formats
  *	Ethan A Merritt - August 2009
@@ -50,6 +50,8 @@
 /* Prototypes of functions exported by breaders.c */
 
 void edf_filetype_function __PROTO((void));
+void arrow_filetype_function __PROTO((void));
+void arrow_reset __PROTO((void));
 void png_filetype_function __PROTO((void));
 void gif_filetype_function __PROTO((void));
 void jpeg_filetype_function __PROTO((void));
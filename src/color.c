@@ -93,6 +93,10 @@ make_palette()
     int i;
     double gray;
 
+    /* Palettes defined by functions may depend on user variables */
+    if (sm_palette.colorMode == SMPAL_COLOR_MODE_FUNCTIONS)
+	invalidate_palette_lut();
+
     if (!term->make_palette) {
 	return 1;
     }
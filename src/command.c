@@ -92,6 +92,7 @@ static char *RCSid() { return RCSid("$Id: command.c,v 1.276 2014/01/12 22:10:17
 #include "setshow.h"
 #include "stats.h"
 #include "tables.h"
+#include "tabulate.h"
 #include "term_api.h"
 #include "util.h"
 
@@ -188,6 +189,15 @@ TBOOLEAN if_open_for_else = FALSE;
 
 static int clause_depth = 0;
 
+/* Inside "do for" and "while" loops print output to a regular file is
+ * flushed once at the end of the loop rather than after every line.
+ * Pipes, terminals and FIFOs are still flushed line by line, and any
+ * pending output is flushed before "pause" or "system" waits and before
+ * df_open() or loadpath_fopen() open a file that might be the one printed.
+ */
+static int iteration_depth = 0;
+static TBOOLEAN print_out_regular = FALSE;
+
 static int command_exit_status = 0;
 
 /* support for dynamic size of input line */
@@ -1158,9 +1168,12 @@ do_command()
     if (empty_iteration(do_iterator))
 	strcpy(clause, ";");
 
+    iteration_depth++;
     do {
 	do_string(clause);
     } while (next_iteration(do_iterator));
+    if (--iteration_depth == 0 && print_out)
+	fflush(print_out);
 
     free(clause);
     do_iterator = cleanup_iteration(do_iterator);
@@ -1188,11 +1201,14 @@ while_command()
     clause[do_end - do_start - 1] = '\0';
     clause_depth++;
 
+    iteration_depth++;
     while (exprval != 0) {
 	do_string(clause);
 	c_token = save_token;
 	exprval = real_expression();
     };
+    if (--iteration_depth == 0 && print_out)
+	fflush(print_out);
 
     free(clause);
     c_token = end_token;
@@ -1343,6 +1359,9 @@ clause_reset_after_error()
     if (clause_depth)
 	FPRINTF((stderr,"CLAUSE RESET after error at depth %d\n",clause_depth));
     clause_depth = 0;
+    if (iteration_depth && print_out)
+	fflush(print_out);
+    iteration_depth = 0;
 }
 
 /* helper routine to multiplex mouse event handling with a timed pause command */
@@ -1449,6 +1468,10 @@ pause_command()
 	}
     }
 
+    /* Output deferred by a loop must not wait for the pause */
+    if (print_out)
+	fflush(print_out);
+
     if (sleep_time < 0) {
 #if defined(_Windows)
 # ifdef WXWIDGETS
@@ -1579,6 +1602,7 @@ print_set_output(char *name, TBOOLEAN append_p)
 	free(print_out_name);
 
     print_out_name = NULL;
+    print_out_regular = FALSE;
 
     if (! name) {
 	print_out = stderr;
@@ -1607,6 +1631,15 @@ print_set_output(char *name, TBOOLEAN append_p)
 	perror(name);
 	return;
     }
+#ifdef HAVE_SYS_STAT_H
+    {
+	struct stat statbuf;
+	if (fstat(fileno(print_out), &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+	    setvbuf(print_out, NULL, _IOFBF, TABLE_BUFSIZE);
+	    print_out_regular = TRUE;
+	}
+    }
+#endif
 
     print_out_name = name;
 }
@@ -1636,11 +1669,11 @@ print_command()
     do {
 	++c_token;
 	if (equals(c_token,"$") && isletter(c_token+1)) {
-	    char **line = get_datablock(parse_datablock_name());
-	    while (line && *line) {
-		fprintf(print_out, "%s\n", *line);
-		line++;
-	    }
+	    struct datablock *data = get_datablock(parse_datablock_name());
+	    char *line;
+	    int i;
+	    for (i = 0; (line = datablock_line(data, i)) != NULL; i++)
+		fprintf(print_out, "%s\n", line);
 	    continue;
 	}
 	const_express(&a);
@@ -1657,7 +1690,8 @@ print_command()
     } while (!END_OF_COMMAND && equals(c_token, ","));
 
     (void) putc('\n', print_out);
-    fflush(print_out);
+    if (iteration_depth == 0 || !print_out_regular)
+	fflush(print_out);
 }
 
 
@@ -2445,6 +2479,8 @@ do_system(const char *cmd)
 
      if (!cmd)
 	return;
+    if (print_out)
+	fflush(print_out);
 
     /* gp_input_line is filled by read_line or load_file, but
      * line_desc length is set only by read_line; adjust now
@@ -2698,6 +2734,8 @@ do_system(const char *cmd)
 # if defined(_Windows) && defined(USE_OWN_WINSYSTEM_FUNCTION)
     if (!cmd)
 	return;
+    if (print_out)
+	fflush(print_out);
     restrict_popen();
     winsystem(cmd);
 # else /* _Windows) */
@@ -2709,6 +2747,8 @@ do_system(const char *cmd)
  */
     if (!cmd)
 	return;
+    if (print_out)
+	fflush(print_out);
     restrict_popen();
     system(cmd);
 # endif /* !(_Windows) */
@@ -3179,6 +3219,9 @@ do_system_func(const char *cmd, char **output)
     static $DESCRIPTOR(lognamedsc, "PLOT$MAILBOX");
 # endif /* VMS */
 
+    if (print_out)
+	fflush(print_out);
+
     /* open stream */
 # ifdef VMS
     pgmdsc.dsc$a_pointer = cmd;
@@ -69,6 +69,9 @@
 #include "misc.h"
 #include "util.h"
 
+static char *datablock_reserve __PROTO((struct datablock *datablock, size_t len));
+static void datablock_commit __PROTO((struct datablock *datablock, size_t len));
+
 /*
  * In-line data blocks are implemented as a here-document:
  * $FOO << EOD
@@ -81,6 +84,7 @@
  * The string EOD is arbitrary; lines of data will be read from the input stream
  * until the leading characters on the line match the given character string.
  * No attempt is made to parse the data at the time it is read in.
+ * Lines are read straight into the datablock buffer and may be of any length.
  */
 void
 datablock_command()
@@ -88,9 +92,8 @@ datablock_command()
     FILE *fin;
     char *name, *eod;
     int nlines;
-    int nsize = 4;
     struct udvt_entry *datablock;
-    char dataline[MAX_LINE_LEN+1];
+    struct datablock *data;
 
     if (!isletter(c_token+1))
 	int_error(c_token, "illegal datablock name");
@@ -103,7 +106,7 @@ datablock_command()
 	gpfree_datablock(&datablock->udv_value);
     datablock->udv_undef = FALSE;
     datablock->udv_value.type = DATABLOCK;
-    datablock->udv_value.v.data_array = NULL;
+    datablock->udv_value.v.data_array = data = new_datablock();
 
     if (!equals(c_token, "<<") || !isletter(c_token+1))
 	int_error(c_token, "data block name must be followed by << EODmarker");
@@ -116,19 +119,26 @@ datablock_command()
     fin = (lf_head == NULL) ? stdin : lf_head->fp;
     if (!fin)
 	int_error(NO_CARET,"attempt to define data block from invalid context");
-    for (nlines = 0; fgets(dataline, MAX_LINE_LEN, fin); nlines++) {
-	if (!strncmp(eod, dataline, strlen(eod)))
-	    break;
-	/* Allocate space for data lines plus at least 2 empty lines at the end. */
-	if (nlines >= nsize-4) {
-	    nsize *= 2;
-	    datablock->udv_value.v.data_array =
-		gp_realloc( datablock->udv_value.v.data_array,
-			nsize * sizeof(char *), "datablock");
-	    memset(&datablock->udv_value.v.data_array[nlines], 0,
-		    (nsize - nlines) * sizeof(char *));
+    for (nlines = 0; ; nlines++) {
+	size_t len = 0;
+	char *dataline;
+
+	/* Read the line into the free space at the end of the buffer,
+	 * making room for more as long as it has not ended.
+	 */
+	for (;;) {
+	    dataline = datablock_reserve(data, len + MAX_LINE_LEN);
+	    if (!fgets(dataline + len, MAX_LINE_LEN, fin))
+		break;
+	    len += strlen(dataline + len);
+	    if (len > 0 && dataline[len-1] == '\n')
+		break;
 	}
-	datablock->udv_value.v.data_array[nlines] = gp_strdup(dataline);
+	if (len == 0 || !strncmp(eod, dataline, strlen(eod)))
+	    break;
+	if (dataline[len-1] == '\n')
+	    dataline[--len] = '\0';
+	datablock_commit(data, len);
     }
     inline_num += nlines + 1;	/* Update position in input file */
 
@@ -136,6 +146,118 @@ datablock_command()
     return;
 }
 
+struct datablock *
+new_datablock()
+{
+    struct datablock *datablock = gp_alloc(sizeof(struct datablock), "datablock");
+
+    memset(datablock, 0, sizeof(struct datablock));
+    return datablock;
+}
+
+/* Return space for a line of up to len characters and its NUL at the end
+ * of the buffer.  It becomes part of the datablock by datablock_commit().
+ */
+static char *
+datablock_reserve(struct datablock *datablock, size_t len)
+{
+    if (datablock->text_used + len + 1 > datablock->text_size) {
+	datablock->text_size = 2 * datablock->text_size + len + 1024;
+	datablock->text = gp_realloc(datablock->text, datablock->text_size,
+				     "datablock");
+    }
+    return datablock->text + datablock->text_used;
+}
+
+static void
+datablock_commit(struct datablock *datablock, size_t len)
+{
+    if (datablock->nlines >= datablock->max_lines) {
+	datablock->max_lines = 2 * datablock->max_lines + 64;
+	datablock->offset = gp_realloc(datablock->offset,
+			datablock->max_lines * sizeof(size_t), "datablock");
+    }
+    datablock->text[datablock->text_used + len] = '\0';
+    datablock->offset[datablock->nlines++] = datablock->text_used;
+    datablock->text_used += len + 1;
+}
+
+/* Add a line, without its newline, to the end of a datablock */
+void
+append_to_datablock(struct datablock *datablock, const char *line)
+{
+    size_t len = strlen(line);
+
+    if (len > 0 && line[len-1] == '\n')
+	len--;
+    memcpy(datablock_reserve(datablock, len), line, len);
+    datablock_commit(datablock, len);
+}
+
+/* Line i of a datablock, or NULL past its end.  The row of a binary
+ * datablock is formatted into a buffer that the next call overwrites.
+ */
+char *
+datablock_line(struct datablock *datablock, int i)
+{
+    double *values;
+    int n, j;
+    char *line;
+
+    if (!datablock || i < 0 || i >= datablock->nlines)
+	return NULL;
+    if (!datablock->binary)
+	return datablock->text + datablock->offset[i];
+
+    n = datablock_row(datablock, i, &values);
+    line = datablock_reserve(datablock, 24 * n + 1);
+    line[0] = '\0';
+    for (j = 0; j < n; j++)
+	sprintf(line + strlen(line), j ? " %g" : "%g", values[j]);
+    return line;
+}
+
+/* Add a number to the row being written to a binary datablock */
+void
+datablock_add_value(struct datablock *datablock, double value)
+{
+    if (datablock->n_values >= datablock->max_values) {
+	datablock->max_values = 2 * datablock->max_values + 1024;
+	datablock->values = gp_realloc(datablock->values,
+			datablock->max_values * sizeof(double), "datablock");
+    }
+    datablock->values[datablock->n_values++] = value;
+}
+
+/* Finish the row being written to a binary datablock.  For these
+ * offset[nlines] is where the next row starts.
+ */
+void
+datablock_end_row(struct datablock *datablock)
+{
+    if (datablock->nlines + 2 > datablock->max_lines) {
+	if (datablock->max_lines == 0) {
+	    datablock->offset = gp_alloc(64 * sizeof(size_t), "datablock");
+	    datablock->offset[0] = 0;
+	    datablock->max_lines = 64;
+	} else {
+	    datablock->max_lines *= 2;
+	    datablock->offset = gp_realloc(datablock->offset,
+			datablock->max_lines * sizeof(size_t), "datablock");
+	}
+    }
+    datablock->offset[++datablock->nlines] = datablock->n_values;
+}
+
+/* Number of values in row i of a binary datablock, and where they are */
+int
+datablock_row(struct datablock *datablock, int i, double **values)
+{
+    if (values)
+	*values = datablock->values + datablock->offset[i];
+    return datablock->offset[i + 1] - datablock->offset[i];
+}
+
 char *
 parse_datablock_name()
 {
@@ -154,14 +276,15 @@ parse_datablock_name()
     return name;
 }
 
-char **
+struct datablock *
 get_datablock(char *name)
 {
     struct udvt_entry *datablock;
 
     datablock = get_udv_by_name(name);
     if (!datablock || datablock->udv_undef
-    ||  datablock->udv_value.v.data_array == NULL)
+    ||  datablock->udv_value.v.data_array == NULL
+    ||  datablock->udv_value.v.data_array->nlines == 0)
 	int_error(NO_CARET,"no datablock named %s",name);
 
     return datablock->udv_value.v.data_array;
@@ -170,14 +293,15 @@ get_datablock(char *name)
 void
 gpfree_datablock(struct value *datablock_value)
 {
-    int i;
-    char **stored_data = datablock_value->v.data_array;
+    struct datablock *stored_data = datablock_value->v.data_array;
 
     if (datablock_value->type != DATABLOCK)
 	return;
-    if (stored_data)
-	for (i=0; stored_data[i] != NULL; i++)
-	    free(stored_data[i]);
-    free(stored_data);
+    if (stored_data) {
+	free(stored_data->text);
+	free(stored_data->offset);
+	free(stored_data->values);
+	free(stored_data);
+    }
     datablock_value->v.data_array = NULL;
 }
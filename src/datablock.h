@@ -1,7 +1,38 @@
 /*
  * $Id: datablock.h,v 1.1 2012/06/19 18:11:05 sfeam Exp $
  */
+#ifndef GNUPLOT_DATABLOCK_H
+# define GNUPLOT_DATABLOCK_H
+
+#include "gp_types.h"
+
+/* The lines of a datablock are kept one after another in a single
+ * buffer, without their newlines.  offset[i] is the start of line i.
+ *
+ * A binary datablock, written by "set table $name binary", holds rows
+ * of numbers instead: row i is values[offset[i]] up to the start of the
+ * next row.  An empty row stands for a blank line.  text is then only
+ * used to show a row as text.
+ */
+struct datablock {
+    char *text;
+    size_t text_used, text_size;
+    size_t *offset;
+    int nlines, max_lines;
+    TBOOLEAN binary;
+    double *values;
+    size_t n_values, max_values;
+};
+
 void datablock_command __PROTO((void));
-char **get_datablock __PROTO((char *name));
+struct datablock *new_datablock __PROTO((void));
+struct datablock *get_datablock __PROTO((char *name));
+char *datablock_line __PROTO((struct datablock *datablock, int i));
+void append_to_datablock __PROTO((struct datablock *datablock, const char *line));
+void datablock_add_value __PROTO((struct datablock *datablock, double value));
+void datablock_end_row __PROTO((struct datablock *datablock));
+int datablock_row __PROTO((struct datablock *datablock, int i, double **values));
 char *parse_datablock_name __PROTO((void));
 void gpfree_datablock __PROTO((struct value *datablock_value));
+
+#endif /* GNUPLOT_DATABLOCK_H */
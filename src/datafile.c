@@ -147,6 +147,7 @@ static char *RCSid() { return RCSid("$Id: datafile.c,v 1.268 2014/01/10 23:26:30
 
 #include "alloc.h"
 #include "axis.h"
+#include "binary.h"
 #include "command.h"
 #include "eval.h"
 #include "gp_time.h"
@@ -159,6 +160,25 @@ static char *RCSid() { return RCSid("$Id: datafile.c,v 1.268 2014/01/10 23:26:30
 #include "breaders.h"
 #include "variable.h" /* For locale handling */
 
+#ifdef HAVE_LIBZ
+# include <zlib.h>
+#endif
+#ifdef HAVE_LIBZSTD
+# include <zstd.h>
+#endif
+/* Compressed files are read through a stdio stream of our own */
+#if (defined(HAVE_LIBZ) || defined(HAVE_LIBZSTD)) \
+    && (defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN))
+# define DF_DECOMPRESS 1
+#endif
+/* and can be read ahead by a thread of their own */
+#if defined(HAVE_LIBPTHREAD) && defined(HAVE_SYS_STAT_H) \
+    && (defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN))
+# define DF_PREFETCH 1
+# include <pthread.h>
+# include <signal.h>
+#endif
+
 /* test to see if the end of an inline datafile is reached */
 #define is_EOF(c) ((c) == 'e' || (c) == 'E')
 
@@ -185,6 +205,24 @@ static void plot_ticlabel_using __PROTO((int));
 static void add_key_entry __PROTO((char *temp_string, int df_datum));
 static char * df_generate_pseudodata __PROTO((void));
 static int df_skip_bytes __PROTO((int nbytes));
+static TBOOLEAN df_seek_same_string __PROTO((const char *, const char *));
+static void df_open_compressed __PROTO((void));
+static void df_open_prefetch __PROTO((void));
+#ifdef DF_PREFETCH
+static FILE *df_prefetch_fopen __PROTO((int, void *));
+#endif
+static void df_seek_open __PROTO((void));
+static void df_project_columns __PROTO((void));
+static TBOOLEAN df_need_column __PROTO((int));
+static TBOOLEAN df_project_at __PROTO((struct at_type *, int));
+static void df_seek_record __PROTO((void));
+static TBOOLEAN df_cache_open __PROTO((void));
+static TBOOLEAN df_follow_open __PROTO((void));
+static char *df_cache_text __PROTO((int));
+static char *df_cache_gets __PROTO((void));
+static void df_cache_tokenise __PROTO((void));
+static void df_cache_note_field __PROTO((int, char *));
+static void df_datablock_tokenise __PROTO((void));
 
 #ifdef BACKWARDS_COMPATIBLE
 static void plot_option_thru __PROTO((void));
@@ -288,7 +326,117 @@ static int df_pseudospan = 0;
 
 /* for datablocks */
 static TBOOLEAN df_datablock = FALSE;
-static char **df_datablock_line = NULL;
+static struct datablock *df_datablock_data = NULL;
+static int df_datablock_line = 0;	/* next line to read */
+
+/* Where the index blocks of recently read ascii data files start.
+ * 'plot "file" index N' can then seek to block N instead of reading
+ * through all the blocks in front of it.  The table of a file is filled
+ * while the file is being read, so it always describes a contiguous run
+ * of blocks 1..n_blocks; block 0 starts at the beginning of the file.
+ */
+#define DF_SEEK_FILES 4
+static struct df_seek_table {
+    TBOOLEAN valid;
+    dev_t device;		/* identify the file and its version */
+    ino_t inode;
+    off_t size;
+    double mtime;
+    char *commentschars;	/* these change what counts as a blank line */
+    char *separators;
+    int n_blocks, max_blocks;
+    struct df_seek_point {
+	long offset;		/* ftell() at the start of the block */
+	int line_number;	/* df_line_number at that point */
+    } *block;			/* block[k] is where index k+1 starts */
+} df_seek_tables[DF_SEEK_FILES];
+static struct df_seek_table *df_seek = NULL;	/* file being read */
+static int df_seek_next_slot = 0;
+
+/* Columnar cache of parsed ascii data files ("set datafile cache <dir>").
+ *
+ * The first time a plain data file is read with the cache enabled it is
+ * parsed in full by df_cache_build() and the result is written to
+ * <dir>/<device>-<inode>.gpcache.  Later reads replay the lines and the
+ * already converted fields from the cache in place of df_gets() and
+ * df_tokenise(), so df_readascii() sees exactly what it would have seen
+ * reading the text.  A cache belongs to one size and mtime of its file
+ * and to the settings that change how lines are split into fields.
+ *
+ * File layout, in native byte order (a cache is not portable):
+ *	struct df_cache_header
+ *	settings key			key_length bytes, padded to 8
+ *	int line_offset[n_lines]	start of each line in the text, padded
+ *	n_blocks blocks of up to DF_CACHE_BLOCK lines, each
+ *	    int n_rows, n_cols, no_cols[n_rows]		padded to 8
+ *	    double datum[n_cols][n_rows]
+ *	    int start[n_cols][n_rows]			field offset in its line or -1
+ *	    signed char good[n_cols][n_rows]		enum DF_STATUS
+ *	    unsigned char where[n_cols][n_rows]		what position points to
+ *							padded to 8
+ *	text				the lines, NUL terminated
+ * no_cols[] is 0 for comment and blank lines.
+ */
+char *df_cache_dir = NULL;
+
+/* Buffers read ahead by a second thread ("set datafile prefetch"), 0 for none */
+int df_prefetch_depth = 0;
+
+#define DF_CACHE_VERSION 1
+#define DF_CACHE_BLOCK 1024
+#define DF_CACHE_PAD(n) (((n) + 7) & ~(size_t)7)
+
+#define DF_CACHE_AT_START 0	/* position == start of the field */
+#define DF_CACHE_AFTER_QUOTE 1	/* position == start + 1 */
+#define DF_CACHE_NO_POSITION 2	/* position == NULL */
+#define DF_CACHE_NOT_EMPTY 4	/* or'ed in if the field holds anything */
+
+struct df_cache_header {
+    char magic[8];
+    int version;
+    int header_size;		/* sizeof(struct df_cache_header) */
+    double source_size;		/* identify the version of the data file */
+    double source_mtime;
+    int key_length;
+    int n_lines;
+    int n_blocks;
+    int text_size;
+};
+
+struct df_cache_block {
+    int n_rows, n_cols;
+    int *no_cols;
+    double *datum;
+    int *start;
+    signed char *good;
+    unsigned char *where;
+};
+
+static struct df_cache {
+    TBOOLEAN valid;
+    unsigned long device;
+    unsigned long inode;
+    char *image;		/* the whole cache file */
+    size_t image_size;
+    TBOOLEAN mapped;		/* image is mmap()ed rather than malloc()ed */
+    struct df_cache_header *header;
+    int *line_offset;
+    struct df_cache_block *block;
+    char *text;
+    int first_block;		/* blocks no longer held, see df_follow_open() */
+} df_cache_loaded;
+static struct df_cache *df_cache = NULL;	/* cache being replayed */
+static int df_cache_line;			/* next line to replay */
+
+/* Field offsets noted by df_tokenise() while a cache is built */
+static TBOOLEAN df_cache_building = FALSE;
+static int *df_cache_field = NULL;
+static int df_cache_field_size = 0;
+static int df_cache_fields_noted = 0;
+
+/* plot 'file' follow {last <n>} */
+static TBOOLEAN df_follow = FALSE;
+static int df_follow_last = 0;	/* lines to keep, 0 for all */
 
 /* parsing stuff */
 struct use_spec_s use_spec[MAXDATACOLS];
@@ -312,7 +460,15 @@ typedef struct df_column_struct {
 static df_column_struct *df_column = NULL;      /* we'll allocate space as needed */
 static int df_max_cols = 0;     /* space allocated */
 static int df_no_cols;          /* cols read */
-static int fast_columns;        /* corey@cac optimization */
+
+/* Column projection, worked out by df_project_columns() from the using
+ * specs.  df_tokenise() only converts the fields marked in
+ * df_column_needed[] and stops after df_last_needed_column.
+ * df_last_needed_column == 0 means that every column may be used.
+ */
+static char *df_column_needed = NULL;	/* [j] is set if column j+1 is used */
+static int df_column_needed_size = 0;
+static int df_last_needed_column = 0;
 
 char *df_tokens[MAXDATACOLS];			/* filled in by df_tokenise */
 static char *df_stringexpression[MAXDATACOLS];	/* filled in after evaluate_at() */
@@ -339,9 +495,16 @@ static char *df_key_title = NULL;     /* filled in from column header if request
  *
  * EAM May 2011 - Add a keyword "nonuniform matrix" to indicate ascii matrix data
  * in the same format as "binary matrix", i.e. with explicit x and y coordinates.
+ *
+ * A "binary matrix" file in the version 1 format of binary.h carries its x and
+ * y coordinates in a separate header block.  They are read into df_matrix_xcoord
+ * and df_matrix_ycoord up front and the data itself is read as a uniform matrix.
  */
 TBOOLEAN df_read_binary;
 TBOOLEAN df_nonuniform_matrix;
+static TBOOLEAN df_matrix_coords = FALSE;
+static double *df_matrix_xcoord = NULL;
+static double *df_matrix_ycoord = NULL;
 int df_plot_mode;
 
 static int df_readascii __PROTO((double [], int));
@@ -360,6 +523,7 @@ static TBOOLEAN rotation_matrix_2D __PROTO((double R[][2], double));
 static TBOOLEAN rotation_matrix_3D __PROTO((double P[][3], double *));
 static int token2tuple __PROTO((double *, int));
 static void df_determine_matrix_info __PROTO((FILE *));
+static TBOOLEAN df_gpbin_matrix_info __PROTO((FILE *));
 static void df_swap_bytes_by_endianess __PROTO((char *, int, int));
 
 typedef enum df_multivalue_type {
@@ -458,10 +622,12 @@ static void (*binary_input_function)(void);	/* Will point to one of the above */
 static void auto_filetype_function(void){}	/* Just a placeholder for auto    */
 
 struct gen_ftable df_bin_filetype_table[] = {
+    {"arrow", arrow_filetype_function},
     {"avs", avs_filetype_function},
     {"bin", raw_filetype_function},
     {"edf", edf_filetype_function},
     {"ehf", edf_filetype_function},
+    {"feather", arrow_filetype_function},
     {"gif", gif_filetype_function},
     {"gpbin", gpbin_filetype_function},
     {"jpeg", jpeg_filetype_function},
@@ -596,6 +762,29 @@ static const char *matrix_general_binary_conflict_msg
 
 #endif
 
+/* A regular binary file is mapped into memory in its entirety by
+ * df_readbinary() and read through the map instead of with fread().
+ * General binary records are then decoded DF_BIN_BLOCK points at a
+ * time, one column after another, into df_bin_block[].
+ */
+static char *df_mmap_base = NULL;	/* start of the mapped file */
+static char *df_mmap_end = NULL;	/* one past the last mapped byte */
+static size_t df_mmap_size = 0;
+
+#define DF_BIN_BLOCK 256
+static double *df_bin_block = NULL;	/* [column][point] decoded values */
+static int df_bin_block_cols = 0;	/* columns allocated in df_bin_block */
+static int df_bin_block_count = 0;	/* points decoded in df_bin_block */
+static int df_bin_block_next = 0;	/* next point to hand out */
+
+/* Column-oriented files are decoded into the same blocks, from the
+ * current row of the current batch of df_columnar. */
+df_column_layout *df_columnar = NULL;
+static int df_columnar_batch = 0;
+static long long df_columnar_row = 0;
+static char *df_columnar_buffer = NULL;	/* for input without a map */
+static size_t df_columnar_buffer_size = 0;
+
 /*}}} */
 
 
@@ -616,8 +805,29 @@ df_gets()
     if (df_pseudodata)
 	return df_generate_pseudodata();
 
-    if (df_datablock)
-	return *(df_datablock_line++);
+    /* The rows of a binary datablock are not converted to text, except
+     * for the ascii matrix reader.  df_readascii() only needs to tell
+     * a blank line from a data line and takes the numbers from the row.
+     */
+    if (df_datablock && df_datablock_data->binary && !df_matrix_file) {
+	static char data_row[] = "0";
+	if (df_datablock_line >= df_datablock_data->nlines)
+	    return NULL;
+	return datablock_row(df_datablock_data, df_datablock_line++, NULL)
+		? data_row : "";
+    }
+
+    /* Return a copy, since df_tokenise() writes into the line */
+    if (df_datablock) {
+	char *dataline = datablock_line(df_datablock_data, df_datablock_line++);
+	if (!dataline)
+	    return NULL;
+	len = strlen(dataline);
+	if (len >= max_line_len)
+	    line = gp_realloc(line, max_line_len = len + 32, "datafile line buffer");
+	memcpy(line, dataline, len + 1);
+	return line;
+    }
 
     if (!fgets(line, max_line_len, data_fp))
 	return NULL;
@@ -654,6 +864,28 @@ df_gets()
 
 /*}}} */
 
+/*{{{  static void df_datablock_tokenise() */
+/* The fields of the current row of a binary datablock */
+static void
+df_datablock_tokenise()
+{
+    double *values;
+    int i, n = datablock_row(df_datablock_data, df_datablock_line - 1, &values);
+
+    for (i = 0; i < MAXDATACOLS; i++)
+	df_tokens[i] = NULL;
+    if (df_max_cols < n)
+	expand_df_column(n + 20);
+    for (i = 0; i < n; i++) {
+	df_column[i].datum = values[i];
+	df_column[i].good = isnan(values[i]) ? DF_UNDEFINED : DF_GOOD;
+	df_column[i].position = NULL;
+    }
+    df_no_cols = n;
+}
+
+/*}}} */
+
 /*{{{  static int df_tokenise(s) */
 static int
 df_tokenise(char *s)
@@ -682,6 +914,8 @@ df_tokenise(char *s)
 	/* have always skipped spaces at this point */
 	df_column[df_no_cols].position = s;
 	in_string = FALSE;
+	if (df_cache_building)
+	    df_cache_note_field(df_no_cols, s);
 
 	/* Keep pointer to start of this token if user wanted it for
 	 * anything, particularly if it is a string */
@@ -711,33 +945,12 @@ df_tokenise(char *s)
 	} else {
 	    int used;
 	    int count;
-	    int dfncp1 = df_no_cols + 1;
 
 	    /* optimizations by Corey Satten, corey@cac.washington.edu */
 	    /* only scanf the field if it is mentioned in one of the using specs */
-	    if ((fast_columns == 0)
-		|| (df_no_use_specs == 0)
-		|| ((df_no_use_specs > 0)
-		    && (use_spec[0].column == dfncp1
-			|| (df_no_use_specs > 1
-			    && (use_spec[1].column == dfncp1
-				|| (df_no_use_specs > 2
-				    && (use_spec[2].column == dfncp1
-				|| (df_no_use_specs > 3
-				    && (use_spec[3].column == dfncp1
-				        || (df_no_use_specs > 4
-				            && (use_spec[4].column == dfncp1
-				                || df_no_use_specs > 5)
-				            )
-				        )
-				    )
-				)
-				    )
-				)
-			    )
-			)
-		    )
-		) {
+	    if (df_last_needed_column == 0
+		|| (df_no_cols < df_last_needed_column
+		    && df_column_needed[df_no_cols])) {
 
 
 		/* This was the [slow] code used through version 4.0
@@ -804,6 +1017,13 @@ df_tokenise(char *s)
 
 	++df_no_cols;
 
+	/* Nothing to the right of the last column used is looked at.
+	 * The first row is always split completely since it may hold
+	 * the column headers, and it tells stats the number of columns.
+	 */
+	if (df_no_cols == df_last_needed_column && df_already_got_headers)
+	    break;
+
 	/* If we are in a quoted string, skip to end of quote */
 	if (in_string) {
 	    do
@@ -947,370 +1167,2183 @@ initialize_use_spec()
 }
 
 
-/*{{{  int df_open(char *file_name, int max_using, plot_header *plot) */
-
-/* open file, parsing using/thru/index stuff return number of using
- * specs [well, we have to return something !]
+/*{{{  static void df_open_compressed() */
+#ifdef DF_DECOMPRESS
+/* A gzip or zstd compressed file opened through df_open_compressed().
+ * The decompressed data are presented as an ordinary stdio stream, so
+ * df_gets(), df_readbinary() and the binary matrix readers do not need to
+ * know about it.  Seeking backwards restarts the decompression; seeking
+ * forwards decompresses and discards, which is still much cheaper than
+ * reading the lines.
  */
-int
-df_open(const char *cmd_filename, int max_using, struct curve_points *plot)
-{
-    int name_token = c_token - 1;
-    TBOOLEAN duplication = FALSE;
-    TBOOLEAN set_index = FALSE, set_every = FALSE;
-    TBOOLEAN set_using = FALSE;
-    TBOOLEAN set_matrix = FALSE;
+struct df_zstream {
+    int fd;			/* the compressed file */
+    off_t pos;			/* offset in the decompressed data */
+    off_t length;		/* size of the decompressed data, -1 if unknown */
+#ifdef HAVE_LIBZ
+    gzFile gz;
+#endif
+#ifdef HAVE_LIBZSTD
+    ZSTD_DStream *zd;
+    ZSTD_inBuffer in;
+    char *inbuf;
+#endif
+};
+static struct df_zstream *df_compressed = NULL;
 
-    fast_columns = 1;           /* corey@cac */
+#define DF_ZBUFSIZE 262144
 
-    /* close file if necessary */
-    if (data_fp) {
-	df_close();
-	data_fp = NULL;
-    }
+static long
+df_zread(struct df_zstream *z, char *buf, size_t size)
+{
+    long n = 0;
 
-    /*{{{  initialise static variables */
-    free(df_format);
-    df_format = NULL;         /* no format string */
+#ifdef HAVE_LIBZ
+    if (z->gz) {
+	if (size > INT_MAX)
+	    size = INT_MAX;
+	n = gzread(z->gz, buf, size);
+    }
+#endif
+#ifdef HAVE_LIBZSTD
+    if (z->zd) {
+	ZSTD_outBuffer out;
+
+	out.dst = buf;
+	out.size = size;
+	out.pos = 0;
+	while (out.pos == 0) {
+	    size_t ret;
+
+	    if (z->in.pos == z->in.size) {
+		ssize_t got = read(z->fd, z->inbuf, DF_ZBUFSIZE);
+		if (got < 0)
+		    return -1;
+		if (got == 0)
+		    break;
+		z->in.size = got;
+		z->in.pos = 0;
+	    }
+	    ret = ZSTD_decompressStream(z->zd, &out, &z->in);
+	    if (ZSTD_isError(ret))
+		return -1;
+	}
+	n = out.pos;
+    }
+#endif
+    if (n > 0)
+	z->pos += n;
+    return n;
+}
 
-    df_no_tic_specs = 0;
-    free(df_key_title);
-    df_key_title = NULL;
+static int
+df_zseek(struct df_zstream *z, off_t offset, int whence)
+{
+    char skip[8192];
+    off_t target;
+
+    if (whence == SEEK_END && z->length < 0) {
+	/* Only found out by decompressing all of it */
+	long n;
+	while ((n = df_zread(z, skip, sizeof(skip))) > 0)
+	    ;
+	if (n < 0)
+	    return -1;
+	z->length = z->pos;
+    }
+    target = (whence == SEEK_SET) ? offset
+	   : (whence == SEEK_CUR) ? z->pos + offset
+	   : z->length + offset;
 
-    initialize_use_spec();
-    clear_df_column_headers();
+    if (target < 0)
+	return -1;
+    if (target == z->pos)
+	return 0;
+    if (target < z->pos) {
+#ifdef HAVE_LIBZ
+	if (z->gz && gzrewind(z->gz) < 0)
+	    return -1;
+#endif
+#ifdef HAVE_LIBZSTD
+	if (z->zd) {
+	    if (lseek(z->fd, 0, SEEK_SET) < 0)
+		return -1;
+	    ZSTD_initDStream(z->zd);
+	    z->in.size = z->in.pos = 0;
+	}
+#endif
+	z->pos = 0;
+    }
+#ifdef HAVE_LIBZ
+    if (z->gz) {
+	if (gzseek(z->gz, target, SEEK_SET) != target)
+	    return -1;
+	z->pos = target;
+    }
+#endif
+    while (z->pos < target) {
+	size_t want = sizeof(skip);
+	if (target - z->pos < (off_t) want)
+	    want = target - z->pos;
+	if (df_zread(z, skip, want) <= 0)
+	    return -1;
+    }
+    return 0;
+}
 
-    df_datum = -1;              /* it will be preincremented before use */
-    df_line_number = 0;         /* ditto */
+static int
+df_zclose(struct df_zstream *z)
+{
+#ifdef HAVE_LIBZ
+    if (z->gz)
+	gzclose(z->gz);	/* also closes fd */
+#endif
+#ifdef HAVE_LIBZSTD
+    if (z->zd) {
+	ZSTD_freeDStream(z->zd);
+	free(z->inbuf);
+	close(z->fd);
+    }
+#endif
+    if (df_compressed == z)
+	df_compressed = NULL;
+    free(z);
+    return 0;
+}
 
-    df_lower_index = 0;
-    df_index_step = 1;
-    df_upper_index = MAXINT;
-    free(indexname);
-    indexname = NULL;
+/* The stdio hooks */
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+df_zcookie_read(void *cookie, char *buf, size_t size)
+{
+    return df_zread(cookie, buf, size);
+}
 
-    df_current_index = 0;
-    blank_count = 2;
-    /* by initialising blank_count, leading blanks will be ignored */
+static int
+df_zcookie_seek(void *cookie, off64_t *offset, int whence)
+{
+    struct df_zstream *z = cookie;
 
-    everypoint = everyline = 1; /* unless there is an every spec */
-    firstpoint = firstline = 0;
-    lastpoint = lastline = MAXINT;
+    if (df_zseek(z, *offset, whence) < 0)
+	return -1;
+    *offset = z->pos;
+    return 0;
+}
 
-    df_binary_file = df_matrix_file = FALSE;
-    df_pixeldata = NULL;
-    df_num_bin_records = 0;
-    df_matrix = FALSE;
-    df_nonuniform_matrix = FALSE;
+static int
+df_zcookie_close(void *cookie)
+{
+    return df_zclose(cookie);
+}
+#else /* funopen() */
+static int
+df_zcookie_read(void *cookie, char *buf, int size)
+{
+    return df_zread(cookie, buf, size);
+}
 
-    df_eof = 0;
+static fpos_t
+df_zcookie_seek(void *cookie, fpos_t offset, int whence)
+{
+    struct df_zstream *z = cookie;
 
-    /* Save for use by df_readline(). */
-    /* Perhaps it should be a parameter to df_readline? */
-    df_current_plot = plot;
-    column_for_key_title = NO_COLUMN_HEADER;
-    parse_1st_row_as_headers = FALSE;
-    df_already_got_headers = FALSE;
-    /*}}} */
+    if (df_zseek(z, offset, whence) < 0)
+	return -1;
+    return z->pos;
+}
 
-    if (!cmd_filename)
-	int_error(c_token, "missing filename");
-    if (!cmd_filename[0]) {
-	if (!df_filename || !*df_filename)
-	    int_error(c_token, "No previous filename");
-    } else {
-	free(df_filename);
-	df_filename = gp_strdup(cmd_filename);
-    }
+static int
+df_zcookie_close(void *cookie)
+{
+    return df_zclose(cookie);
+}
+#endif /* HAVE_FOPENCOOKIE */
+#endif /* DF_DECOMPRESS */
 
-    /* defer opening until we have parsed the modifiers... */
+/* If the file just opened starts with the magic number of gzip or zstd,
+ * replace data_fp by a stream of the decompressed contents.
+ * Only regular files are looked at: reading the magic number consumes it,
+ * and a pipe or FIFO cannot be rewound to give it back.
+ */
+static void
+df_open_compressed()
+{
+    unsigned char magic[4];
+    size_t n;
+    const char *format = NULL;
+    TBOOLEAN supported = FALSE;
+#ifdef DF_DECOMPRESS
+    struct df_zstream *z;
+    TBOOLEAN ready = FALSE;
+    FILE *fp = NULL;
+#endif
+#ifdef HAVE_SYS_STAT_H
+    struct stat statbuf;
 
-#ifdef BACKWARDS_COMPATIBLE
-    free_at(ydata_func.at);
-    ydata_func.at = NULL;
+    if (fstat(fileno(data_fp), &statbuf) < 0 || !S_ISREG(statbuf.st_mode))
+	return;
+#else
+    return;
 #endif
 
-    /* pm 25.11.2001 allow any order of options */
-    while (!END_OF_COMMAND) {
+    n = fread(magic, 1, sizeof(magic), data_fp);
+    rewind(data_fp);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+	format = "gzip";
+    else if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5
+	     && magic[2] == 0x2f && magic[3] == 0xfd)
+	format = "zstd";
+    if (!format)
+	return;
 
-	/* look for binary / matrix */
-	if (almost_equals(c_token, "bin$ary")) {
-	    if (df_filename[0] == '$')
-		int_error(c_token, "data blocks cannot be binary");
-	    c_token++;
-	    if (df_binary_file) {
-		duplication=TRUE;
-		break;
-	    }
-	    df_binary_file = TRUE;
-	    /* Up to the time of adding the general binary code, only matrix
-	     * binary for 3d was defined.  So, use matrix binary by default.
-	     */
-	    df_matrix_file = TRUE;
-	    initialize_binary_vars();
-	    plot_option_binary(set_matrix, FALSE);
-	    continue;
+#if defined(DF_DECOMPRESS) && defined(HAVE_LIBZ)
+    if (*format == 'g')
+	supported = TRUE;
+#endif
+#if defined(DF_DECOMPRESS) && defined(HAVE_LIBZSTD)
+    if (*format == 'z')
+	supported = TRUE;
+#endif
+    if (!supported)
+	int_error(NO_CARET, "%s compressed data files are not supported by this copy of gnuplot", format);
+
+#ifdef DF_DECOMPRESS
+    z = gp_alloc(sizeof(struct df_zstream), "datafile");
+    memset(z, 0, sizeof(*z));
+    z->length = -1;
+    z->fd = dup(fileno(data_fp));
+    if (z->fd >= 0 && lseek(z->fd, 0, SEEK_SET) == 0) {
+#ifdef HAVE_LIBZ
+	if (*format == 'g' && (z->gz = gzdopen(z->fd, "rb")) != NULL) {
+	    gzbuffer(z->gz, DF_ZBUFSIZE);
+	    ready = TRUE;
 	}
-
-	/* deal with matrix */
-	if (almost_equals(c_token, "mat$rix")) {
-	    c_token++;
-	    if (set_matrix) {
-		duplication=TRUE;
-		break;
-	    }
-	    /* `binary` default is both df_matrix_file and df_binary_file.
-	     * So if df_binary_file is true, but df_matrix_file isn't, then
-	     * some keyword specific to general binary has been given.
-	     */
-	    if (!df_matrix_file && df_binary_file)
-		int_error(c_token, matrix_general_binary_conflict_msg);
-	    df_matrix_file = TRUE;
-	    set_matrix = TRUE;
-	    fast_columns = 0;
-	    continue;
+#endif
+#ifdef HAVE_LIBZSTD
+	if (*format == 'z' && (z->zd = ZSTD_createDStream()) != NULL) {
+	    ZSTD_initDStream(z->zd);
+	    z->inbuf = gp_alloc(DF_ZBUFSIZE, "datafile");
+	    z->in.src = z->inbuf;
+	    ready = TRUE;
 	}
-
-	/* May 2011 - "nonuniform matrix" indicates an ascii data file
-	 * with the same row/column layout as "binary matrix" */
-	if (almost_equals(c_token, "nonuni$form")) {
-	    c_token++;
-	    df_matrix_file = TRUE;
-	    df_nonuniform_matrix = TRUE;
-	    fast_columns = 0;
-	    continue;
+#endif
+    }
+#ifdef DF_PREFETCH
+    if (ready && df_prefetch_depth >= 2)
+	fp = df_prefetch_fopen(-1, z);
+#endif
+    if (ready && !fp) {
+#ifdef HAVE_FOPENCOOKIE
+	cookie_io_functions_t hooks;
+	hooks.read = df_zcookie_read;
+	hooks.write = NULL;
+	hooks.seek = df_zcookie_seek;
+	hooks.close = df_zcookie_close;
+	fp = fopencookie(z, "r", hooks);
+#else
+	fp = funopen(z, df_zcookie_read, NULL, df_zcookie_seek, df_zcookie_close);
+#endif
+    }
+    if (!fp) {
+	if (ready)
+	    df_zclose(z);
+	else {
+	    if (z->fd >= 0)
+		close(z->fd);
+	    free(z);
 	}
+	int_error(NO_CARET, "cannot read %s compressed data file \"%s\"",
+		  format, df_filename);
+    }
+    fclose(data_fp);
+    data_fp = fp;
+    setvbuf(data_fp, NULL, _IOFBF, DF_ZBUFSIZE);
+    df_compressed = z;
+#endif /* DF_DECOMPRESS */
+}
 
-	/* deal with index */
-	if (almost_equals(c_token, "i$ndex")) {
-	    if (set_index) { duplication=TRUE; break; }
-	    plot_option_index();
-	    set_index = TRUE;
-	    continue;
-	}
+/*{{{  static void df_open_prefetch() */
+#ifdef DF_PREFETCH
+/* A data file read ahead by a thread of its own ("set datafile prefetch").
+ * The thread fills a ring of df_prefetch_depth large buffers, with pread()
+ * or with the output of the decompressor, while the main thread takes the
+ * data out of them through a stdio stream, so df_gets(), df_readbinary()
+ * and the binary filetype readers are served from memory while the next
+ * buffers are on their way.  A seek that does not land in the data already
+ * read discards the buffers and sends the thread on from there.
+ */
+#define DF_PREFETCH_BUFSIZE 1048576
 
-	/* deal with every */
-	if (almost_equals(c_token, "ev$ery")) {
-	    if (set_every) { duplication=TRUE; break; }
-	    plot_option_every();
-	    set_every = TRUE;
-	    continue;
-	}
+struct df_prefetch {
+    int fd;			/* the file, or -1 ... */
+#ifdef DF_DECOMPRESS
+    struct df_zstream *z;	/* ... for the stream decompressing it */
+#endif
+    int depth;
+    struct df_prefetch_buffer {
+	char *data;
+	long len;
+    } *buf;
+    int head, count;		/* filled buffers, oldest first */
+    long used;			/* bytes of buf[head] already taken */
+    off_t pos;			/* offset of the next byte to be taken */
+    off_t fill_pos;		/* offset of the next byte to be read ahead */
+    TBOOLEAN started;		/* buffers allocated on the first read */
+    TBOOLEAN threaded;		/* else read in the main thread */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;	/* signalled by either side */
+    int generation;		/* incremented by each seek */
+    TBOOLEAN busy;		/* the thread is reading */
+    TBOOLEAN at_end, failed, stop;
+};
+static struct df_prefetch *df_prefetched = NULL;
 
-#ifdef BACKWARDS_COMPATIBLE
-	/* deal with thru */
-	/* jev -- support for passing data from file thru user function */
-	if (almost_equals(c_token, "thru$")) {
-	    plot_option_thru();
-	    continue;
-	}
+/* Read size bytes at offset pos from the file or from the decompressor */
+static long
+df_prefetch_source(struct df_prefetch *p, char *buf, size_t size, off_t pos)
+{
+    ssize_t n;
+
+#ifdef DF_DECOMPRESS
+    if (p->z) {
+	if (p->z->pos != pos && df_zseek(p->z, pos, SEEK_SET) < 0)
+	    return -1;
+	return df_zread(p->z, buf, size);
+    }
 #endif
+    do {
+	n = pread(p->fd, buf, size, pos);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
 
-	/* deal with using */
-	if (almost_equals(c_token, "u$sing")) {
-	    if (set_using) { duplication=TRUE; break; }
-	    plot_option_using(max_using);
-	    set_using = TRUE;
+static void *
+df_prefetch_thread(void *arg)
+{
+    struct df_prefetch *p = arg;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->stop) {
+	struct df_prefetch_buffer *b;
+	int generation;
+	off_t pos;
+	long n;
+
+	if (p->count == p->depth || p->at_end || p->failed) {
+	    pthread_cond_wait(&p->changed, &p->lock);
 	    continue;
 	}
-
-	/* deal with volatile */
-	if (almost_equals(c_token, "volatile")) {
+	b = &p->buf[(p->head + p->count) % p->depth];
+	generation = p->generation;
+	pos = p->fill_pos;
+	p->busy = TRUE;
+	pthread_mutex_unlock(&p->lock);
+
+	n = df_prefetch_source(p, b->data, DF_PREFETCH_BUFSIZE, pos);
+
+	pthread_mutex_lock(&p->lock);
+	p->busy = FALSE;
+	/* Unless a seek has made the data useless */
+	if (generation == p->generation) {
+	    if (n > 0) {
+		b->len = n;
+		p->count++;
+		p->fill_pos += n;
+	    } else if (n == 0)
+		p->at_end = TRUE;
+	    else
+		p->failed = TRUE;
+	}
+	pthread_cond_broadcast(&p->changed);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/* Allocate the buffers and start the thread.  If either fails, the data
+ * are read in the main thread as they are asked for.
+ */
+static void
+df_prefetch_start(struct df_prefetch *p)
+{
+    sigset_t all, old;
+    int i;
+
+    p->started = TRUE;
+    p->buf = calloc(p->depth, sizeof(struct df_prefetch_buffer));
+    if (!p->buf)
+	return;
+    for (i = 0; i < p->depth; i++)
+	if (!(p->buf[i].data = malloc(DF_PREFETCH_BUFSIZE)))
+	    return;
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->changed, NULL);
+    /* Signals are for the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    p->threaded = (pthread_create(&p->thread, NULL, df_prefetch_thread, p) == 0);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (!p->threaded) {
+	pthread_mutex_destroy(&p->lock);
+	pthread_cond_destroy(&p->changed);
+    }
+}
+
+static long
+df_prefetch_read(struct df_prefetch *p, char *buf, size_t size)
+{
+    long n = 0;
+
+    if (!p->started)
+	df_prefetch_start(p);
+    if (!p->threaded) {
+	n = df_prefetch_source(p, buf, size, p->pos);
+	if (n > 0)
+	    p->pos += n;
+	return n;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    while (p->count == 0 && !p->at_end && !p->failed)
+	pthread_cond_wait(&p->changed, &p->lock);
+    if (p->count > 0) {
+	struct df_prefetch_buffer *b = &p->buf[p->head];
+
+	n = b->len - p->used;
+	if ((size_t) n > size)
+	    n = size;
+	memcpy(buf, b->data + p->used, n);
+	p->used += n;
+	p->pos += n;
+	if (p->used == b->len) {
+	    p->head = (p->head + 1) % p->depth;
+	    p->count--;
+	    p->used = 0;
+	    pthread_cond_broadcast(&p->changed);
+	}
+    } else if (p->failed)
+	n = -1;
+    pthread_mutex_unlock(&p->lock);
+    return n;
+}
+
+static int
+df_prefetch_seek(struct df_prefetch *p, off_t *offset, int whence)
+{
+    off_t target;
+
+    if (p->threaded)
+	pthread_mutex_lock(&p->lock);
+
+    if (whence == SEEK_SET)
+	target = *offset;
+    else if (whence == SEEK_CUR)
+	target = p->pos + *offset;
+    else {
+	struct stat statbuf;
+
+	target = -1;
+#ifdef DF_DECOMPRESS
+	if (p->z) {
+	    /* The thread must leave the decompressor alone meanwhile */
+	    p->generation++;
+	    while (p->busy)
+		pthread_cond_wait(&p->changed, &p->lock);
+	    if (df_zseek(p->z, *offset, SEEK_END) == 0)
+		target = p->z->pos;
+	} else
+#endif
+	if (fstat(p->fd, &statbuf) == 0)
+	    target = statbuf.st_size + *offset;
+    }
+
+    if (target < 0 || target == p->pos)
+	;
+    else if (p->threaded) {
+	/* Look for the target in what has been read ahead */
+	if (target < p->pos && p->count > 0 && p->pos - target <= p->used) {
+	    p->used -= p->pos - target;
+	    p->pos = target;
+	}
+	while (target > p->pos && p->count > 0) {
+	    struct df_prefetch_buffer *b = &p->buf[p->head];
+	    long skip = b->len - p->used;
+
+	    if (target - p->pos < skip)
+		skip = target - p->pos;
+	    p->used += skip;
+	    p->pos += skip;
+	    if (p->used == b->len) {
+		p->head = (p->head + 1) % p->depth;
+		p->count--;
+		p->used = 0;
+	    }
+	}
+	if (target != p->pos) {
+	    p->generation++;
+	    p->head = p->count = 0;
+	    p->used = 0;
+	    p->at_end = p->failed = FALSE;
+	    p->pos = p->fill_pos = target;
+	}
+	pthread_cond_broadcast(&p->changed);
+    } else
+	p->pos = p->fill_pos = target;
+
+    if (p->threaded)
+	pthread_mutex_unlock(&p->lock);
+    if (target < 0)
+	return -1;
+    *offset = target;
+    return 0;
+}
+
+static int
+df_prefetch_close(struct df_prefetch *p)
+{
+    int i;
+
+    if (p->threaded) {
+	pthread_mutex_lock(&p->lock);
+	p->stop = TRUE;
+	pthread_cond_broadcast(&p->changed);
+	pthread_mutex_unlock(&p->lock);
+	pthread_join(p->thread, NULL);
+	pthread_mutex_destroy(&p->lock);
+	pthread_cond_destroy(&p->changed);
+    }
+#ifdef DF_DECOMPRESS
+    if (p->z)
+	df_zclose(p->z);
+    else
+#endif
+	close(p->fd);
+    if (p->buf)
+	for (i = 0; i < p->depth; i++)
+	    free(p->buf[i].data);
+    free(p->buf);
+    if (df_prefetched == p)
+	df_prefetched = NULL;
+    free(p);
+    return 0;
+}
+
+/* The stdio hooks */
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+df_prefetch_cookie_read(void *cookie, char *buf, size_t size)
+{
+    return df_prefetch_read(cookie, buf, size);
+}
+
+static int
+df_prefetch_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+    off_t target = *offset;
+
+    if (df_prefetch_seek(cookie, &target, whence) < 0)
+	return -1;
+    *offset = target;
+    return 0;
+}
+
+static int
+df_prefetch_cookie_close(void *cookie)
+{
+    return df_prefetch_close(cookie);
+}
+#else /* funopen() */
+static int
+df_prefetch_cookie_read(void *cookie, char *buf, int size)
+{
+    return df_prefetch_read(cookie, buf, size);
+}
+
+static fpos_t
+df_prefetch_cookie_seek(void *cookie, fpos_t offset, int whence)
+{
+    off_t target = offset;
+
+    if (df_prefetch_seek(cookie, &target, whence) < 0)
+	return -1;
+    return target;
+}
+
+static int
+df_prefetch_cookie_close(void *cookie)
+{
+    return df_prefetch_close(cookie);
+}
+#endif /* HAVE_FOPENCOOKIE */
+
+/* A stdio stream reading fd, or z if fd is -1, through a prefetching
+ * thread.  Closing the stream closes fd or z.  Returns NULL on failure.
+ */
+static FILE *
+df_prefetch_fopen(int fd, void *z)
+{
+    struct df_prefetch *p = gp_alloc(sizeof(struct df_prefetch), "datafile");
+    FILE *fp;
+#ifdef HAVE_FOPENCOOKIE
+    cookie_io_functions_t hooks;
+#endif
+
+    memset(p, 0, sizeof(*p));
+    p->fd = fd;
+#ifdef DF_DECOMPRESS
+    p->z = z;
+#endif
+    p->depth = df_prefetch_depth;
+#ifdef HAVE_FOPENCOOKIE
+    hooks.read = df_prefetch_cookie_read;
+    hooks.write = NULL;
+    hooks.seek = df_prefetch_cookie_seek;
+    hooks.close = df_prefetch_cookie_close;
+    fp = fopencookie(p, "r", hooks);
+#else
+    fp = funopen(p, df_prefetch_cookie_read, NULL,
+		 df_prefetch_cookie_seek, df_prefetch_cookie_close);
+#endif
+    if (!fp) {
+	free(p);
+	return NULL;
+    }
+    df_prefetched = p;
+    return fp;
+}
+#endif /* DF_PREFETCH */
+
+/* Read the plain file just opened through a prefetching thread, if
+ * "set datafile prefetch" asks for it.  Compressed files have been
+ * handed to one by df_open_compressed().
+ */
+static void
+df_open_prefetch()
+{
+#ifdef DF_PREFETCH
+    struct stat statbuf;
+    FILE *fp;
+    int fd;
+
+    if (df_prefetch_depth < 2 || df_prefetched
+    ||  fstat(fileno(data_fp), &statbuf) < 0 || !S_ISREG(statbuf.st_mode))
+	return;
+    if ((fd = dup(fileno(data_fp))) < 0)
+	return;
+    if (!(fp = df_prefetch_fopen(fd, NULL))) {
+	close(fd);
+	return;
+    }
+    fclose(data_fp);
+    data_fp = fp;
+    setvbuf(data_fp, NULL, _IOFBF, DF_ZBUFSIZE);
+#endif /* DF_PREFETCH */
+}
+/*}}} */
+
+#ifdef HAVE_SYS_STAT_H
+/* fstat() of the file being read, or of the compressed file behind it */
+static int
+df_stat_data(struct stat *statbuf)
+{
+#ifdef DF_PREFETCH
+    if (df_prefetched && df_prefetched->fd >= 0)
+	return fstat(df_prefetched->fd, statbuf);
+#endif
+#ifdef DF_DECOMPRESS
+    if (df_compressed)
+	return fstat(df_compressed->fd, statbuf);
+#endif
+    return fstat(fileno(data_fp), statbuf);
+}
+
+/* Modification time of a file, to the nanosecond where it is known */
+static double
+df_stat_mtime(struct stat *statbuf)
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+    return statbuf->st_mtim.tv_sec + 1e-9 * statbuf->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+    return statbuf->st_mtimespec.tv_sec + 1e-9 * statbuf->st_mtimespec.tv_nsec;
+#else
+    return statbuf->st_mtime;
+#endif
+}
+#endif
+
+/*}}} */
+
+
+/*{{{  int df_open(char *file_name, int max_using, plot_header *plot) */
+
+/* open file, parsing using/thru/index stuff return number of using
+ * specs [well, we have to return something !]
+ */
+int
+df_open(const char *cmd_filename, int max_using, struct curve_points *plot)
+{
+    int name_token = c_token - 1;
+    TBOOLEAN duplication = FALSE;
+    TBOOLEAN set_index = FALSE, set_every = FALSE;
+    TBOOLEAN set_using = FALSE;
+    TBOOLEAN set_matrix = FALSE;
+
+    /* close file if necessary */
+    if (data_fp) {
+	df_close();
+	data_fp = NULL;
+    }
+
+    /* The data may be what a loop has just printed */
+    if (print_out)
+	fflush(print_out);
+
+    /*{{{  initialise static variables */
+    free(df_format);
+    df_format = NULL;         /* no format string */
+
+    df_no_tic_specs = 0;
+    free(df_key_title);
+    df_key_title = NULL;
+
+    initialize_use_spec();
+    clear_df_column_headers();
+
+    df_datum = -1;              /* it will be preincremented before use */
+    df_line_number = 0;         /* ditto */
+
+    df_lower_index = 0;
+    df_index_step = 1;
+    df_upper_index = MAXINT;
+    free(indexname);
+    indexname = NULL;
+
+    df_current_index = 0;
+    blank_count = 2;
+    /* by initialising blank_count, leading blanks will be ignored */
+
+    everypoint = everyline = 1; /* unless there is an every spec */
+    firstpoint = firstline = 0;
+    lastpoint = lastline = MAXINT;
+
+    df_binary_file = df_matrix_file = FALSE;
+    df_pixeldata = NULL;
+    df_free_columnar();
+    df_num_bin_records = 0;
+    df_matrix = FALSE;
+    df_nonuniform_matrix = FALSE;
+    df_matrix_coords = FALSE;
+
+    df_eof = 0;
+    df_follow = FALSE;
+    df_follow_last = 0;
+
+    /* Save for use by df_readline(). */
+    /* Perhaps it should be a parameter to df_readline? */
+    df_current_plot = plot;
+    column_for_key_title = NO_COLUMN_HEADER;
+    parse_1st_row_as_headers = FALSE;
+    df_already_got_headers = FALSE;
+    /*}}} */
+
+    if (!cmd_filename)
+	int_error(c_token, "missing filename");
+    if (!cmd_filename[0]) {
+	if (!df_filename || !*df_filename)
+	    int_error(c_token, "No previous filename");
+    } else {
+	free(df_filename);
+	df_filename = gp_strdup(cmd_filename);
+    }
+
+    /* defer opening until we have parsed the modifiers... */
+
+#ifdef BACKWARDS_COMPATIBLE
+    free_at(ydata_func.at);
+    ydata_func.at = NULL;
+#endif
+
+    /* pm 25.11.2001 allow any order of options */
+    while (!END_OF_COMMAND) {
+
+	/* look for binary / matrix */
+	if (almost_equals(c_token, "bin$ary")) {
+	    if (df_filename[0] == '$')
+		int_error(c_token, "data blocks cannot be binary");
 	    c_token++;
-	    volatile_data = TRUE;
+	    if (df_binary_file) {
+		duplication=TRUE;
+		break;
+	    }
+	    df_binary_file = TRUE;
+	    /* Up to the time of adding the general binary code, only matrix
+	     * binary for 3d was defined.  So, use matrix binary by default.
+	     */
+	    df_matrix_file = TRUE;
+	    initialize_binary_vars();
+	    plot_option_binary(set_matrix, FALSE);
+	    continue;
+	}
+
+	/* deal with matrix */
+	if (almost_equals(c_token, "mat$rix")) {
+	    c_token++;
+	    if (set_matrix) {
+		duplication=TRUE;
+		break;
+	    }
+	    /* `binary` default is both df_matrix_file and df_binary_file.
+	     * So if df_binary_file is true, but df_matrix_file isn't, then
+	     * some keyword specific to general binary has been given.
+	     */
+	    if (!df_matrix_file && df_binary_file)
+		int_error(c_token, matrix_general_binary_conflict_msg);
+	    df_matrix_file = TRUE;
+	    set_matrix = TRUE;
+	    continue;
+	}
+
+	/* May 2011 - "nonuniform matrix" indicates an ascii data file
+	 * with the same row/column layout as "binary matrix" */
+	if (almost_equals(c_token, "nonuni$form")) {
+	    c_token++;
+	    df_matrix_file = TRUE;
+	    df_nonuniform_matrix = TRUE;
+	    continue;
+	}
+
+	/* deal with index */
+	if (almost_equals(c_token, "i$ndex")) {
+	    if (set_index) { duplication=TRUE; break; }
+	    plot_option_index();
+	    set_index = TRUE;
 	    continue;
 	}
 
-	/* Allow this plot not to affect autoscaling */
-	if (almost_equals(c_token, "noauto$scale")) {
-	    c_token++;
-	    plot->noautoscale = TRUE;
-	    continue;
+	/* deal with every */
+	if (almost_equals(c_token, "ev$ery")) {
+	    if (set_every) { duplication=TRUE; break; }
+	    plot_option_every();
+	    set_every = TRUE;
+	    continue;
+	}
+
+#ifdef BACKWARDS_COMPATIBLE
+	/* deal with thru */
+	/* jev -- support for passing data from file thru user function */
+	if (almost_equals(c_token, "thru$")) {
+	    plot_option_thru();
+	    continue;
+	}
+#endif
+
+	/* deal with using */
+	if (almost_equals(c_token, "u$sing")) {
+	    if (set_using) { duplication=TRUE; break; }
+	    plot_option_using(max_using);
+	    set_using = TRUE;
+	    continue;
+	}
+
+	/* deal with follow */
+	if (almost_equals(c_token, "follow")) {
+	    if (df_follow) { duplication=TRUE; break; }
+	    c_token++;
+	    df_follow = TRUE;
+	    if (equals(c_token, "last")) {
+		c_token++;
+		df_follow_last = int_expression();
+		if (df_follow_last < 1)
+		    int_error(c_token, "Expected positive integer");
+	    }
+	    continue;
+	}
+
+	/* deal with volatile */
+	if (almost_equals(c_token, "volatile")) {
+	    c_token++;
+	    volatile_data = TRUE;
+	    continue;
+	}
+
+	/* Allow this plot not to affect autoscaling */
+	if (almost_equals(c_token, "noauto$scale")) {
+	    c_token++;
+	    plot->noautoscale = TRUE;
+	    continue;
+	}
+
+	break; /* unknown option */
+
+    } /* while (!END_OF_COMMAND) */
+
+    if (duplication)
+	int_error(c_token,
+		  "duplicated or contradicting arguments in datafile options");
+
+    /* Check for auto-generation of key title from column header  */
+    /* Mar 2009:  This may no longer be the best place for this!  */
+    if ((&keyT)->auto_titles == COLUMNHEAD_KEYTITLES) {
+	if (df_no_use_specs == 1)
+	    column_for_key_title = use_spec[0].column;
+	else if (plot && plot->plot_type == DATA3D)
+	    column_for_key_title = use_spec[2].column;
+	else
+	    column_for_key_title = use_spec[1].column;
+    }
+
+    df_project_columns();
+
+    /*{{{  more variable inits */
+    point_count = -1;           /* we preincrement */
+    line_count = 0;
+    df_pseudodata = 0;
+    df_pseudorecord = 0;
+    df_pseudospan = 0;
+    df_datablock = FALSE;
+    df_datablock_data = NULL;
+    df_datablock_line = 0;
+    df_seek = NULL;
+    df_cache = NULL;
+    df_cache_building = FALSE;
+
+    /* here so it's not done for every line in df_readline */
+    if (max_line_len < DATA_LINE_BUFSIZ) {
+	max_line_len = DATA_LINE_BUFSIZ;
+	line = gp_alloc(max_line_len, "datafile line buffer");
+    }
+    /*}}} */
+
+    /*{{{  open file */
+#if defined(HAVE_FDOPEN)
+    if (*df_filename == '<' && strlen(df_filename) > 1 && df_filename[1] == '&') {
+	char *substr;
+	/* read from an already open file descriptor */
+	data_fd = strtol(df_filename + 2, &substr, 10);
+	if (*substr != '\0' || data_fd < 0 || substr == df_filename+2)
+	    int_error(name_token, "invalid file descriptor integer");
+	else if (data_fd == fileno(stdin)
+	     ||  data_fd == fileno(stdout)
+	     ||  data_fd == fileno(stderr))
+	    int_error(name_token, "cannot plot from stdin/stdout/stderr");
+	else if ((data_fp = fdopen(data_fd, "r")) == (FILE *) NULL)
+	    int_error(name_token, "cannot open file descriptor for reading data");
+    } else
+#endif /* HAVE_FDOPEN */
+#if defined(PIPES)
+    if (*df_filename == '<') {
+	restrict_popen();
+	if ((data_fp = popen(df_filename + 1, "r")) == (FILE *) NULL)
+	    os_error(name_token, "cannot create pipe for data");
+	else
+	    df_pipe_open = TRUE;
+    } else
+#endif /* PIPES */
+
+    /* Special filenames '-' '+' '++' '$DATABLOCK' */
+    if (*df_filename == '-' && strlen(df_filename) == 1) {
+	plotted_data_from_stdin = TRUE;
+	volatile_data = TRUE;
+	data_fp = lf_top();
+	if (!data_fp)
+	    data_fp = stdin;
+	mixed_data_fp = TRUE;   /* don't close command file */
+    } else if (df_filename[0] == '+') {
+	if (strlen(df_filename) == 1)
+	    df_pseudodata = 1;
+	else if (df_filename[1] == '+' && strlen(df_filename) == 2)
+	    df_pseudodata = 2;
+    } else if (df_filename[0] == '$') {
+	df_datablock = TRUE;
+	df_datablock_data = get_datablock(df_filename);
+	if (df_datablock_data->binary && df_format)
+	    int_error(NO_CARET, "a binary datablock cannot be read with a format string");
+	/* nor has it a header row for "set key autotitle columnhead" */
+	if (df_datablock_data->binary)
+	    column_for_key_title = NO_COLUMN_HEADER;
+    } else {
+
+	/* filename cannot be static array! */
+	gp_expand_tilde(&df_filename);
+#ifdef HAVE_SYS_STAT_H
+	{
+	    struct stat statbuf;
+	    if ((stat(df_filename, &statbuf) > -1) &&
+		S_ISDIR(statbuf.st_mode)) {
+		os_error(name_token, "\"%s\" is a directory",
+			df_filename);
+	    }
+	}
+#endif /* HAVE_SYS_STAT_H */
+
+	if ((data_fp = loadpath_fopen(df_filename, df_binary_file ? "rb" : "r")) == NULL) {
+	    int_warn(NO_CARET, "Skipping unreadable file \"%s\"", df_filename);
+	    df_eof = 1;
+	    return DF_EOF;
+	}
+	df_open_compressed();
+	df_open_prefetch();
+
+	/* Replay a cached or followed parse of the file, or else skip
+	 * directly to the first requested index if we know where it is */
+	if (!df_binary_file && !df_matrix_file
+	&&  !(df_follow ? df_follow_open() : df_cache_open()))
+	    df_seek_open();
+    }
+/*}}} */
+
+
+    /* If the data is in binary matrix form, read in some values
+     * to determine the nubmer of columns and rows.  If data is in
+     * ASCII matrix form, read in all the data to memory in preparation
+     * for using df_readbinary() routine.
+     */
+    if (df_matrix_file)
+	df_determine_matrix_info(data_fp);
+
+    /* General binary, matrix binary and ASCII matrix all use the
+     * df_readbinary() routine.
+     */
+    if (df_binary_file || df_matrix_file) {
+	df_read_binary = TRUE;
+	adjust_binary_use_spec();
+    } else
+	df_read_binary = FALSE;
+
+    /* Make information about whether the data forms a grid or not
+     * available to the outside world.  */
+    df_matrix = (df_matrix_file
+		 || ((df_num_bin_records == 1) 
+		     && ((df_bin_record[0].cart_dim[1] > 0)
+			 || (df_bin_record[0].scan_dim[1] > 0))));
+
+    return df_no_use_specs;
+}
+
+/*}}} */
+
+/*{{{  void df_close() */
+void
+df_close()
+{
+    int i;
+
+    /* paranoid - mark $n and column(n) as invalid */
+    df_no_cols = 0;
+
+    if (!data_fp && !df_datablock)
+	return;
+
+#ifdef BACKWARDS_COMPATIBLE
+    free_at(ydata_func.at);
+    ydata_func.at = NULL;
+#endif
+
+    /* free any use expression storage */
+    for (i = 0; i < MAXDATACOLS; ++i)
+	if (use_spec[i].at) {
+	    free_at(use_spec[i].at);
+	    use_spec[i].at = NULL;
+	}
+
+    /* free binary matrix data */
+    if (df_matrix) {
+	for (i = 0; i < df_num_bin_records; i++) {
+	    free(df_bin_record[i].memory_data);
+	    df_bin_record[i].memory_data = NULL;
+	}
+    }
+
+#ifdef USE_MMAP
+    if (df_mmap_base) {
+	munmap(df_mmap_base, df_mmap_size);
+	df_mmap_base = df_mmap_end = NULL;
+	df_mmap_size = 0;
+    }
+#endif
+    df_bin_block_count = df_bin_block_next = 0;
+    df_free_columnar();
+
+    if (!mixed_data_fp && !df_datablock) {
+#if defined(HAVE_FDOPEN)
+	if (data_fd == fileno(data_fp)) {
+	    /* This will allow replotting if this stream is backed by a file,
+	     * and hopefully is harmless if it connects to a pipe.
+	     * Leave it open in either case.
+	     */
+	    rewind(data_fp);
+	    fprintf(stderr,"Rewinding fd %d\n", data_fd);
+	} else
+#endif
+#if defined(PIPES)
+	if (df_pipe_open) {
+	    (void) pclose(data_fp);
+	    df_pipe_open = FALSE;
+	} else
+#endif /* PIPES */
+	    (void) fclose(data_fp);
+    }
+    mixed_data_fp = FALSE;
+    data_fp = NULL;
+    df_seek = NULL;
+    df_cache = NULL;
+}
+
+/*}}} */
+
+/*{{{  void df_project_columns() */
+/* Work out which columns the using specs refer to.  Anything that can
+ * reach a column not known at this point, e.g. column(<variable>) or
+ * pseudocolumn -3 (last column), makes all columns needed.
+ */
+static void
+df_project_columns()
+{
+    int i;
+
+    df_last_needed_column = 0;
+    if (df_no_use_specs == 0 || df_format || df_matrix_file || df_binary_file)
+	return;
+    if (df_column_needed_size > 0)
+	memset(df_column_needed, 0, df_column_needed_size);
+
+    for (i = 0; i < df_no_use_specs + df_no_tic_specs; i++) {
+	if (use_spec[i].at) {
+	    if (!df_project_at(use_spec[i].at, 0))
+		break;
+	} else if (!df_need_column(use_spec[i].column))
+	    break;
+    }
+    if (i < df_no_use_specs + df_no_tic_specs)
+	df_last_needed_column = 0;
+}
+
+/* Mark a column as used.  Returns FALSE if it could be any column */
+static TBOOLEAN
+df_need_column(int column)
+{
+    if (column < -2)
+	return FALSE;
+    if (column <= 0)	/* pseudocolumns 0, -1, -2 */
+	return TRUE;
+    if (column > df_column_needed_size) {
+	int old_size = df_column_needed_size;
+	df_column_needed_size = column + 32;
+	df_column_needed = gp_realloc(df_column_needed, df_column_needed_size,
+					"datafile columns");
+	memset(df_column_needed + old_size, 0, df_column_needed_size - old_size);
+    }
+    df_column_needed[column-1] = 1;
+    if (df_last_needed_column < column)
+	df_last_needed_column = column;
+    return TRUE;
+}
+
+/* Mark the columns used by an expression, including the bodies of the
+ * user functions it calls.  Returns FALSE if they cannot be determined.
+ */
+static TBOOLEAN
+df_project_at(struct at_type *at, int depth)
+{
+    int i;
+
+    if (depth > 8)	/* maybe a recursive function */
+	return FALSE;
+
+    for (i = 0; i < at->a_count; i++) {
+	int operator = at->actions[i].index;
+	union argument *arg = &at->actions[i].arg;
+
+	if (operator == DOLLARS) {
+	    if (arg->v_arg.type != INTGR || !df_need_column(arg->v_arg.v.int_val))
+		return FALSE;
+	} else if (operator == CALL || operator == CALLN || operator == SUM) {
+	    if (arg->udf_arg->at && !df_project_at(arg->udf_arg->at, depth+1))
+		return FALSE;
+	} else if (operator >= SF_START
+		&& (ft[operator].func == f_column
+		    || ft[operator].func == f_stringcolumn
+		    || ft[operator].func == f_columnhead
+		    || ft[operator].func == f_valid
+		    || ft[operator].func == f_timecolumn)) {
+	    /* Only a constant argument tells us the column */
+	    struct at_entry *previous;
+	    if (i == 0)
+		return FALSE;
+	    previous = &at->actions[i-1];
+	    if (previous->index != PUSHC
+	    ||  previous->arg.v_arg.type != INTGR
+	    ||  !df_need_column(previous->arg.v_arg.v.int_val))
+		return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+/*}}} */
+
+/*{{{  void df_seek_open(), df_seek_record() */
+/* Compare two strings that may be NULL */
+static TBOOLEAN
+df_seek_same_string(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL)
+	return (a == b);
+    return !strcmp(a, b);
+}
+
+/* Look up the block table of the file just opened, throw it away if the
+ * file or the settings that determine its blocks have changed, and
+ * position the file at the start of the first requested index.
+ */
+static void
+df_seek_open()
+{
+#ifdef HAVE_SYS_STAT_H
+    struct stat statbuf;
+    struct df_seek_table *table = NULL;
+    int i;
+
+    df_seek = NULL;
+    if (indexname || df_stat_data(&statbuf) < 0
+    ||  !S_ISREG(statbuf.st_mode))
+	return;
+
+    for (i = 0; i < DF_SEEK_FILES; i++) {
+	if (df_seek_tables[i].valid
+	&&  df_seek_tables[i].device == statbuf.st_dev
+	&&  df_seek_tables[i].inode == statbuf.st_ino) {
+	    table = &df_seek_tables[i];
+	    break;
+	}
+    }
+    if (table
+    &&  (table->size != statbuf.st_size || table->mtime != df_stat_mtime(&statbuf)
+	|| !df_seek_same_string(table->commentschars, df_commentschars)
+	|| !df_seek_same_string(table->separators, df_separators)))
+	table->valid = FALSE;
+    if (!table || !table->valid) {
+	if (!table) {
+	    table = &df_seek_tables[df_seek_next_slot];
+	    df_seek_next_slot = (df_seek_next_slot + 1) % DF_SEEK_FILES;
+	}
+	free(table->commentschars);
+	free(table->separators);
+	table->valid = TRUE;
+	table->device = statbuf.st_dev;
+	table->inode = statbuf.st_ino;
+	table->size = statbuf.st_size;
+	table->mtime = df_stat_mtime(&statbuf);
+	table->commentschars = gp_strdup(df_commentschars);
+	table->separators = gp_strdup(df_separators);
+	table->n_blocks = 0;
+    }
+    df_seek = table;
+
+    /* Blank lines in front of the first requested index are not reported
+     * to the caller, so jumping over them is invisible to it.  Resume in
+     * the state df_readascii() is in after the second blank line.
+     */
+    i = (df_lower_index < table->n_blocks) ? df_lower_index : table->n_blocks;
+    if (i > 0 && fseek(data_fp, table->block[i-1].offset, SEEK_SET) == 0) {
+	df_current_index = i;
+	df_line_number = table->block[i-1].line_number;
+	blank_count = 2;
+	line_count = 0;
+	df_datum = -1;
+    }
+#endif
+}
+
+/* Called when df_readascii() enters a new index block */
+static void
+df_seek_record()
+{
+    struct df_seek_table *table = df_seek;
+    long offset;
+
+    if (df_current_index != table->n_blocks + 1)
+	return;
+    if ((offset = ftell(data_fp)) < 0) {
+	df_seek = NULL;
+	return;
+    }
+    if (table->n_blocks >= table->max_blocks) {
+	table->max_blocks = 2 * table->max_blocks + 64;
+	table->block = gp_realloc(table->block,
+			table->max_blocks * sizeof(struct df_seek_point),
+			"datafile index table");
+    }
+    table->block[table->n_blocks].offset = offset;
+    table->block[table->n_blocks].line_number = df_line_number;
+    table->n_blocks++;
+}
+
+/*}}} */
+
+/*{{{  TBOOLEAN df_cache_open(), df_cache_gets(), df_cache_tokenise() */
+/* Called by df_tokenise() at the start of every field while a cache is built */
+static void
+df_cache_note_field(int column, char *s)
+{
+    if (column >= df_cache_field_size) {
+	df_cache_field_size = column + 64;
+	df_cache_field = gp_realloc(df_cache_field,
+			df_cache_field_size * sizeof(int), "datafile cache");
+    }
+    df_cache_field[column] = s - line;
+    df_cache_fields_noted = column + 1;
+}
+
+#ifdef HAVE_SYS_STAT_H
+/* Settings that change how the lines of a file are split and converted */
+static char *
+df_cache_key()
+{
+    const char *part[4];
+    size_t len = 64;
+    char *key;
+    int i;
+
+    part[0] = df_separators;
+    part[1] = df_commentschars;
+    part[2] = missing_val;
+    part[3] = numeric_locale;
+    for (i = 0; i < 4; i++)
+	if (part[i])
+	    len += strlen(part[i]) + 2;
+    key = gp_alloc(len, "datafile cache key");
+    sprintf(key, "fortran %d", df_fortran_constants);
+    for (i = 0; i < 4; i++)
+	sprintf(key + strlen(key), "\n%c%s", part[i] ? '+' : '-',
+		part[i] ? part[i] : "");
+    return key;
+}
+
+/* Check a cache image read from disk and set up the pointers into it */
+static TBOOLEAN
+df_cache_parse(struct df_cache *cache, const char *key)
+{
+    struct df_cache_header *header = (struct df_cache_header *)cache->image;
+    size_t size = cache->image_size;
+    size_t pos = DF_CACHE_PAD(sizeof(struct df_cache_header));
+    int i, lines = 0;
+    size_t j;
+
+    if (size < pos || memcmp(header->magic, "GPDCACHE", 8)
+    ||  header->version != DF_CACHE_VERSION
+    ||  header->header_size != sizeof(struct df_cache_header)
+    ||  header->key_length < 0 || header->n_lines < 0
+    ||  header->n_blocks < 0 || header->text_size <= 0
+    ||  header->n_blocks > header->n_lines / DF_CACHE_BLOCK + 1)
+	return FALSE;
+    cache->header = header;
+
+    if (size - pos < DF_CACHE_PAD(header->key_length)
+    ||  (size_t) header->key_length != strlen(key)
+    ||  memcmp(cache->image + pos, key, header->key_length))
+	return FALSE;
+    pos += DF_CACHE_PAD(header->key_length);
+
+    if ((size - pos) / sizeof(int) < (size_t) header->n_lines)
+	return FALSE;
+    cache->line_offset = (int *)(cache->image + pos);
+    pos += DF_CACHE_PAD(header->n_lines * sizeof(int));
+    for (i = 0; i < header->n_lines; i++)
+	if (cache->line_offset[i] < 0 || cache->line_offset[i] >= header->text_size)
+	    return FALSE;
+
+    free(cache->block);
+    cache->block = gp_alloc((header->n_blocks + 1) * sizeof(struct df_cache_block),
+			    "datafile cache");
+    for (i = 0; i < header->n_blocks; i++) {
+	struct df_cache_block *block = &cache->block[i];
+	int *dims = (int *)(cache->image + pos);
+	size_t n;
+
+	if (size - pos < 2 * sizeof(int))
+	    return FALSE;
+	block->n_rows = dims[0];
+	block->n_cols = dims[1];
+	/* all blocks but the last are full, see df_cache_tokenise() */
+	if (block->n_rows <= 0 || block->n_rows > DF_CACHE_BLOCK
+	||  (i < header->n_blocks - 1 && block->n_rows != DF_CACHE_BLOCK)
+	||  block->n_cols < 0 || block->n_cols > INT_MAX / DF_CACHE_BLOCK)
+	    return FALSE;
+	n = (size_t) block->n_rows * block->n_cols;
+	if (size - pos < DF_CACHE_PAD((2 + block->n_rows) * sizeof(int))
+			 + DF_CACHE_PAD(n * (sizeof(double) + sizeof(int) + 2)))
+	    return FALSE;
+	block->no_cols = dims + 2;
+	pos += DF_CACHE_PAD((2 + block->n_rows) * sizeof(int));
+	block->datum = (double *)(cache->image + pos);
+	pos += n * sizeof(double);
+	block->start = (int *)(cache->image + pos);
+	pos += n * sizeof(int);
+	block->good = (signed char *)(cache->image + pos);
+	pos += n;
+	block->where = (unsigned char *)(cache->image + pos);
+	pos = DF_CACHE_PAD(pos + n);
+
+	if (lines + block->n_rows > header->n_lines)
+	    return FALSE;
+	for (j = 0; j < block->n_rows; j++)
+	    if (block->no_cols[j] < 0 || block->no_cols[j] > block->n_cols)
+		return FALSE;
+	/* Every field must start inside the text, at or after its line */
+	for (j = 0; j < n; j++) {
+	    int start = block->start[j];
+	    long line_start = cache->line_offset[lines + j % block->n_rows];
+	    int where = block->where[j] & ~DF_CACHE_NOT_EMPTY;
+
+	    if (start < -1 || line_start + start >= header->text_size
+	    ||  where > DF_CACHE_NO_POSITION
+	    ||  (where != DF_CACHE_NO_POSITION && start < 0)
+	    ||  (where == DF_CACHE_AFTER_QUOTE
+		 && line_start + start + 1 >= header->text_size))
+		return FALSE;
 	}
+	lines += block->n_rows;
+    }
+    if (lines != header->n_lines || size - pos != header->text_size)
+	return FALSE;
+    cache->text = cache->image + pos;
+    if (cache->text[header->text_size - 1] != '\0')
+	return FALSE;
+    return TRUE;
+}
 
-	break; /* unknown option */
+/* Output of df_cache_build() before it is put together */
+struct df_cache_buffer {
+    char *data;
+    size_t len, size;
+};
 
-    } /* while (!END_OF_COMMAND) */
+static void *
+df_cache_append(struct df_cache_buffer *buf, const void *data, size_t len)
+{
+    void *dest;
 
-    if (duplication)
-	int_error(c_token,
-		  "duplicated or contradicting arguments in datafile options");
+    if (buf->len + len + 8 > buf->size) {
+	buf->size = 2 * buf->size + len + 4096;
+	buf->data = gp_realloc(buf->data, buf->size, "datafile cache");
+    }
+    dest = buf->data + buf->len;
+    if (data)
+	memcpy(dest, data, len);
+    else
+	memset(dest, 0, len);
+    buf->len += len;
+    return dest;
+}
 
-    /* Check for auto-generation of key title from column header  */
-    /* Mar 2009:  This may no longer be the best place for this!  */
-    if ((&keyT)->auto_titles == COLUMNHEAD_KEYTITLES) {
-	if (df_no_use_specs == 1)
-	    column_for_key_title = use_spec[0].column;
-	else if (plot && plot->plot_type == DATA3D)
-	    column_for_key_title = use_spec[2].column;
-	else
-	    column_for_key_title = use_spec[1].column;
+static void
+df_cache_align(struct df_cache_buffer *buf)
+{
+    df_cache_append(buf, NULL, DF_CACHE_PAD(buf->len) - buf->len);
+}
+
+/* Fields of the lines of one block, stored row by row while it is read */
+struct df_cache_rows {
+    int n_rows;
+    int no_cols[DF_CACHE_BLOCK];
+    int first[DF_CACHE_BLOCK];	/* index of the row's first field */
+    int n_fields, max_fields;
+    double *datum;
+    int *start;
+    signed char *good;
+    unsigned char *where;
+};
+
+/* Transpose the rows collected so far into a columnar block */
+static void
+df_cache_emit_block(struct df_cache_buffer *out, struct df_cache_rows *rows)
+{
+    int dims[2];
+    int n_rows = rows->n_rows;
+    int n_cols = 0;
+    int r, c;
+    size_t n;
+    double *datum;
+    int *start;
+    signed char *good;
+    unsigned char *where;
+
+    for (r = 0; r < n_rows; r++)
+	if (n_cols < rows->no_cols[r])
+	    n_cols = rows->no_cols[r];
+    n = (size_t) n_rows * n_cols;
+
+    dims[0] = n_rows;
+    dims[1] = n_cols;
+    df_cache_append(out, dims, sizeof(dims));
+    df_cache_append(out, rows->no_cols, n_rows * sizeof(int));
+    df_cache_align(out);
+    /* one append, since it may move the buffer */
+    datum = df_cache_append(out, NULL,
+			DF_CACHE_PAD(n * (sizeof(double) + sizeof(int) + 2)));
+    start = (int *)(datum + n);
+    good = (signed char *)(start + n);
+    where = (unsigned char *)(good + n);
+
+    for (r = 0; r < n_rows; r++) {
+	for (c = 0; c < n_cols; c++) {
+	    size_t k = (size_t) c * n_rows + r;
+	    int f = rows->first[r] + c;
+
+	    if (c < rows->no_cols[r]) {
+		datum[k] = rows->datum[f];
+		start[k] = rows->start[f];
+		good[k] = rows->good[f];
+		where[k] = rows->where[f];
+	    } else {
+		start[k] = -1;
+		where[k] = DF_CACHE_NO_POSITION;
+	    }
+	}
     }
+}
 
-    /*{{{  more variable inits */
-    point_count = -1;           /* we preincrement */
-    line_count = 0;
-    df_pseudodata = 0;
-    df_pseudorecord = 0;
-    df_pseudospan = 0;
-    df_datablock = FALSE;
-    df_datablock_line = NULL;
+/* A parse of the lines of a file in progress */
+struct df_cache_builder {
+    struct df_cache_buffer blocks;	/* the full blocks */
+    struct df_cache_buffer text;
+    struct df_cache_buffer offsets;
+    struct df_cache_rows rows;		/* lines not yet in a block */
+    int n_lines, n_blocks;
+};
 
-    /* here so it's not done for every line in df_readline */
-    if (max_line_len < DATA_LINE_BUFSIZ) {
-	max_line_len = DATA_LINE_BUFSIZ;
-	line = gp_alloc(max_line_len, "datafile line buffer");
+static void
+df_cache_builder_free(struct df_cache_builder *b)
+{
+    free(b->blocks.data);
+    free(b->text.data);
+    free(b->offsets.data);
+    free(b->rows.datum);
+    free(b->rows.start);
+    free(b->rows.good);
+    free(b->rows.where);
+    memset(b, 0, sizeof(*b));
+}
+
+/* Read and split lines of data_fp up to its end and add them to b.
+ * Every field is converted, as if the using spec asked for all of them.
+ * If end is not NULL a last line without a newline is left unread and
+ * *end is set to the offset in the file following the lines taken.
+ * Returns FALSE if the text is too long to be kept.
+ */
+static TBOOLEAN
+df_cache_read_lines(struct df_cache_builder *b, long *end)
+{
+    struct df_cache_rows *rows = &b->rows;
+    int save_last_needed = df_last_needed_column;
+    TBOOLEAN ok = TRUE;
+    long partial = 0;
+    char *s;
+    int j;
+#ifdef HAVE_LOCALE_H
+    char *save_locale = gp_strdup(setlocale(LC_NUMERIC, NULL));
+#endif
+
+    df_last_needed_column = 0;
+    df_cache_building = TRUE;
+    set_numeric_locale();
+
+    while (ok && (s = df_gets()) != NULL) {
+	int offset = b->text.len;
+	int no_cols = 0;
+
+	if (end && feof(data_fp)) {
+	    /* still being written */
+	    partial = strlen(line);
+	    break;
+	}
+
+	while (isspace((unsigned char) *s) && NOTSEP)
+	    ++s;
+	if (*s && !is_comment(*s)) {
+	    df_cache_fields_noted = 0;
+	    no_cols = df_tokenise(s);
+	    if (rows->n_fields + no_cols > rows->max_fields) {
+		rows->max_fields = 2 * rows->max_fields + no_cols + 256;
+		rows->datum = gp_realloc(rows->datum,
+				rows->max_fields * sizeof(double), "datafile cache");
+		rows->start = gp_realloc(rows->start,
+				rows->max_fields * sizeof(int), "datafile cache");
+		rows->good = gp_realloc(rows->good, rows->max_fields, "datafile cache");
+		rows->where = gp_realloc(rows->where, rows->max_fields, "datafile cache");
+	    }
+	    for (j = 0; j < no_cols; j++) {
+		int f = rows->n_fields + j;
+		int start = (j < df_cache_fields_noted) ? df_cache_field[j] : -1;
+		char *position = df_column[j].position;
+
+		rows->datum[f] = df_column[j].datum;
+		rows->good[f] = df_column[j].good;
+		rows->start[f] = start;
+		if (start < 0 || !position)
+		    rows->where[f] = DF_CACHE_NO_POSITION;
+		else if (position == line + start + 1)
+		    rows->where[f] = DF_CACHE_AFTER_QUOTE;
+		else
+		    rows->where[f] = DF_CACHE_AT_START;
+
+		/* Would df_tokenise() count this field as present if it
+		 * skipped the conversion?  (Only columns that are used
+		 * by the plot are converted.)
+		 */
+		if (position && df_column[j].good != DF_STRINGDATA
+		&&  df_column[j].good != DF_MISSING) {
+		    s = position;
+		    while (isspace((unsigned char) *s) && NOTSEP)
+			++s;
+		    if (*s && NOTSEP)
+			rows->where[f] |= DF_CACHE_NOT_EMPTY;
+		}
+	    }
+	}
+	rows->first[rows->n_rows] = rows->n_fields;
+	rows->no_cols[rows->n_rows++] = no_cols;
+	rows->n_fields += no_cols;
+	if (rows->n_rows == DF_CACHE_BLOCK) {
+	    df_cache_emit_block(&b->blocks, rows);
+	    rows->n_rows = 0;
+	    rows->n_fields = 0;
+	    b->n_blocks++;
+	}
+
+	df_cache_append(&b->offsets, &offset, sizeof(int));
+	df_cache_append(&b->text, line, strlen(line) + 1);
+	b->n_lines++;
+	if (b->text.len > INT_MAX)
+	    ok = FALSE;
     }
-    /*}}} */
+    if (end)
+	*end = ftell(data_fp) - partial;
+
+    df_cache_building = FALSE;
+    df_last_needed_column = save_last_needed;
+#ifdef HAVE_LOCALE_H
+    setlocale(LC_NUMERIC, save_locale);
+    free(save_locale);
+#endif
+    return ok;
+}
 
-    /*{{{  open file */
-#if defined(HAVE_FDOPEN)
-    if (*df_filename == '<' && strlen(df_filename) > 1 && df_filename[1] == '&') {
-	char *substr;
-	/* read from an already open file descriptor */
-	data_fd = strtol(df_filename + 2, &substr, 10);
-	if (*substr != '\0' || data_fd < 0 || substr == df_filename+2)
-	    int_error(name_token, "invalid file descriptor integer");
-	else if (data_fd == fileno(stdin)
-	     ||  data_fd == fileno(stdout)
-	     ||  data_fd == fileno(stderr))
-	    int_error(name_token, "cannot plot from stdin/stdout/stderr");
-	else if ((data_fp = fdopen(data_fd, "r")) == (FILE *) NULL)
-	    int_error(name_token, "cannot open file descriptor for reading data");
-    } else
-#endif /* HAVE_FDOPEN */
-#if defined(PIPES)
-    if (*df_filename == '<') {
-	restrict_popen();
-	if ((data_fp = popen(df_filename + 1, "r")) == (FILE *) NULL)
-	    os_error(name_token, "cannot create pipe for data");
-	else
-	    df_pipe_open = TRUE;
-    } else
-#endif /* PIPES */
+/* Drop the image of a cache file */
+static void
+df_cache_release(struct df_cache *cache)
+{
+#ifdef USE_MMAP
+    if (cache->mapped)
+	munmap(cache->image, cache->image_size);
+    else
+#endif
+	free(cache->image);
+    cache->image = NULL;
+    cache->image_size = 0;
+    cache->mapped = FALSE;
+    cache->valid = FALSE;
+}
 
-    /* Special filenames '-' '+' '++' '$DATABLOCK' */
-    if (*df_filename == '-' && strlen(df_filename) == 1) {
-	plotted_data_from_stdin = TRUE;
-	volatile_data = TRUE;
-	data_fp = lf_top();
-	if (!data_fp)
-	    data_fp = stdin;
-	mixed_data_fp = TRUE;   /* don't close command file */
-    } else if (df_filename[0] == '+') {
-	if (strlen(df_filename) == 1)
-	    df_pseudodata = 1;
-	else if (df_filename[1] == '+' && strlen(df_filename) == 2)
-	    df_pseudodata = 2;
-    } else if (df_filename[0] == '$') {
-	df_datablock = TRUE;
-	df_datablock_line = get_datablock(df_filename);
-    } else {
+/* Write the parts of a cache file to fp, padded as df_cache_parse() wants */
+static TBOOLEAN
+df_cache_put(FILE *fp, const void *data, size_t len, TBOOLEAN pad)
+{
+    static const char zero[8] = { 0 };
+    size_t padding = pad ? DF_CACHE_PAD(len) - len : 0;
 
-	/* filename cannot be static array! */
-	gp_expand_tilde(&df_filename);
-#ifdef HAVE_SYS_STAT_H
-	{
-	    struct stat statbuf;
-	    if ((stat(df_filename, &statbuf) > -1) &&
-		S_ISDIR(statbuf.st_mode)) {
-		os_error(name_token, "\"%s\" is a directory",
-			df_filename);
+    return (len == 0 || fwrite(data, 1, len, fp) == len)
+	&& (padding == 0 || fwrite(zero, 1, padding, fp) == padding);
+}
+
+/* Write a cache file to <dir>/<device>-<inode>.gpcache, going through a
+ * temporary file so that a cache being read is never seen half written.
+ */
+static TBOOLEAN
+df_cache_write(struct df_cache_header *header, const char *key,
+	       struct df_cache_builder *b, const char *name)
+{
+    char *tmpname = gp_alloc(strlen(name) + 5, "datafile cache");
+    FILE *fp;
+    TBOOLEAN ok;
+
+    sprintf(tmpname, "%s.tmp", name);
+    if ((fp = fopen(tmpname, "wb")) == NULL) {
+	int_warn(NO_CARET, "cannot create datafile cache %s", tmpname);
+	free(tmpname);
+	return FALSE;
+    }
+    ok = df_cache_put(fp, header, sizeof(*header), TRUE)
+      && df_cache_put(fp, key, header->key_length, TRUE)
+      && df_cache_put(fp, b->offsets.data, b->offsets.len, TRUE)
+      && df_cache_put(fp, b->blocks.data, b->blocks.len, FALSE)
+      && df_cache_put(fp, b->text.data, b->text.len, FALSE);
+    if (fclose(fp) != 0)
+	ok = FALSE;
+    if (ok && rename(tmpname, name) != 0) {
+	/* Some systems will not rename over an existing file */
+	remove(name);
+	ok = (rename(tmpname, name) == 0);
+    }
+    if (!ok) {
+	int_warn(NO_CARET, "cannot write datafile cache %s", name);
+	remove(tmpname);
+    }
+    free(tmpname);
+    return ok;
+}
+
+/* Read a cache file written earlier for the same version of the data file.
+ * The file is mapped read-only where possible, so that it costs page cache
+ * rather than memory of its own while it stays loaded between plots.
+ */
+static TBOOLEAN
+df_cache_read(struct df_cache *cache, const char *name,
+	      struct stat *statbuf, const char *key)
+{
+    FILE *fp = fopen(name, "rb");
+    struct stat cachestat;
+    TBOOLEAN ok = FALSE;
+
+    if (!fp)
+	return FALSE;
+    df_cache_release(cache);
+    if (fstat(fileno(fp), &cachestat) == 0 && cachestat.st_size > 0
+    &&  (off_t)(size_t) cachestat.st_size == cachestat.st_size) {
+	cache->image_size = cachestat.st_size;
+#ifdef USE_MMAP
+	cache->image = mmap(NULL, cache->image_size, PROT_READ, MAP_SHARED,
+			    fileno(fp), 0);
+	if (cache->image == MAP_FAILED)
+	    cache->image = NULL;
+	else
+	    cache->mapped = TRUE;
+#endif
+	if (!cache->image) {
+	    cache->image = gp_alloc(cache->image_size, "datafile cache");
+	    if (fread(cache->image, 1, cache->image_size, fp) != cache->image_size) {
+		fclose(fp);
+		df_cache_release(cache);
+		return FALSE;
 	    }
 	}
-#endif /* HAVE_SYS_STAT_H */
+	ok = df_cache_parse(cache, key)
+	  && cache->header->source_size == (double) statbuf->st_size
+	  && cache->header->source_mtime == df_stat_mtime(statbuf);
+    }
+    fclose(fp);
+    if (!ok)
+	df_cache_release(cache);
+    return ok;
+}
 
-	if ((data_fp = loadpath_fopen(df_filename, df_binary_file ? "rb" : "r")) == NULL) {
-	    int_warn(NO_CARET, "Skipping unreadable file \"%s\"", df_filename);
-	    df_eof = 1;
-	    return DF_EOF;
+/* Read and split the whole of data_fp and write its cache file.  The file
+ * is then read back by df_cache_read(), so that the parse does not stay in
+ * memory.  If it cannot be written the cache is kept in memory instead.
+ */
+static TBOOLEAN
+df_cache_build(struct df_cache *cache, struct stat *statbuf, const char *key,
+	       const char *name)
+{
+    struct df_cache_builder b;
+    struct df_cache_header header;
+    TBOOLEAN ok;
+
+    df_cache_release(cache);
+    memset(&b, 0, sizeof(b));
+    ok = df_cache_read_lines(&b, NULL);
+    if (b.rows.n_rows > 0) {
+	df_cache_emit_block(&b.blocks, &b.rows);
+	b.n_blocks++;
+    }
+    if (b.text.len == 0)
+	df_cache_append(&b.text, NULL, 1);
+
+    if (ok) {
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "GPDCACHE", 8);
+	header.version = DF_CACHE_VERSION;
+	header.header_size = sizeof(header);
+	header.source_size = statbuf->st_size;
+	header.source_mtime = df_stat_mtime(statbuf);
+	header.key_length = strlen(key);
+	header.n_lines = b.n_lines;
+	header.n_blocks = b.n_blocks;
+	header.text_size = b.text.len;
+
+	if (df_cache_write(&header, key, &b, name)) {
+	    df_cache_builder_free(&b);
+	    return df_cache_read(cache, name, statbuf, key);
+	} else {
+	    size_t pos;
+
+	    cache->image_size = DF_CACHE_PAD(sizeof(header))
+			      + DF_CACHE_PAD(header.key_length)
+			      + DF_CACHE_PAD(b.offsets.len) + b.blocks.len + b.text.len;
+	    cache->image = gp_alloc(cache->image_size, "datafile cache");
+	    memset(cache->image, 0, cache->image_size);
+	    memcpy(cache->image, &header, sizeof(header));
+	    pos = DF_CACHE_PAD(sizeof(header));
+	    memcpy(cache->image + pos, key, header.key_length);
+	    pos += DF_CACHE_PAD(header.key_length);
+	    if (b.offsets.len)
+		memcpy(cache->image + pos, b.offsets.data, b.offsets.len);
+	    pos += DF_CACHE_PAD(b.offsets.len);
+	    if (b.blocks.len)
+		memcpy(cache->image + pos, b.blocks.data, b.blocks.len);
+	    pos += b.blocks.len;
+	    memcpy(cache->image + pos, b.text.data, b.text.len);
+	    ok = df_cache_parse(cache, key);
 	}
     }
-/*}}} */
 
+    df_cache_builder_free(&b);
+    return ok;
+}
 
-    /* If the data is in binary matrix form, read in some values
-     * to determine the nubmer of columns and rows.  If data is in
-     * ASCII matrix form, read in all the data to memory in preparation
-     * for using df_readbinary() routine.
-     */
-    if (df_matrix_file)
-	df_determine_matrix_info(data_fp);
+/* Point block at the columnar block stored at data.  Returns its size. */
+static size_t
+df_cache_block_at(struct df_cache_block *block, char *data)
+{
+    int *dims = (int *)data;
+    size_t n = (size_t) dims[0] * dims[1];
+    size_t pos = DF_CACHE_PAD((2 + dims[0]) * sizeof(int));
+
+    block->n_rows = dims[0];
+    block->n_cols = dims[1];
+    block->no_cols = dims + 2;
+    block->datum = (double *)(data + pos);
+    block->start = (int *)(block->datum + n);
+    block->good = (signed char *)(block->start + n);
+    block->where = (unsigned char *)(block->good + n);
+    return pos + DF_CACHE_PAD(n * (sizeof(double) + sizeof(int) + 2));
+}
 
-    /* General binary, matrix binary and ASCII matrix all use the
-     * df_readbinary() routine.
-     */
-    if (df_binary_file || df_matrix_file) {
-	df_read_binary = TRUE;
-	adjust_binary_use_spec();
-    } else
-	df_read_binary = FALSE;
+/* Files plotted with the "follow" option.  Each remembers how far its
+ * file has been read and the lines parsed so far, so that the next plot
+ * only reads what has been appended since.  The lines are replayed like
+ * those of a cache file.
+ */
+static struct df_follow_file {
+    struct df_follow_file *next;
+    char *filename;
+    unsigned long device;
+    unsigned long inode;
+    char *key;			/* df_cache_key() of the parse */
+    long end;			/* offset in the file after the lines read */
+    double mtime;
+    struct df_cache_builder parse;
+    struct df_cache_buffer tail;	/* parse.rows as a block */
+    struct df_cache_header header;
+    struct df_cache cache;
+} *df_follow_files = NULL;
+
+/* Let go of the blocks of lines that come before the last 'keep' lines,
+ * once there are as many of them as blocks still held, so that the cost
+ * of moving what is left is spread over the lines read since.
+ */
+static void
+df_follow_trim(struct df_follow_file *f, int keep)
+{
+    struct df_cache_builder *b = &f->parse;
+    struct df_cache_block block;
+    int held = b->n_blocks - f->cache.first_block;
+    int drop, n_lines, i;
+    size_t bytes = 0;
+    int *offset, text_base;
+
+    if (keep <= 0)
+	return;
+    drop = (b->n_lines - keep) / DF_CACHE_BLOCK - f->cache.first_block;
+    if (drop <= 0 || drop < held - drop)
+	return;
+
+    for (i = 0; i < drop; i++)
+	bytes += df_cache_block_at(&block, b->blocks.data + bytes);
+    memmove(b->blocks.data, b->blocks.data + bytes, b->blocks.len - bytes);
+    b->blocks.len -= bytes;
+
+    /* At least 'keep' lines remain after those dropped */
+    offset = (int *) b->offsets.data;
+    n_lines = b->offsets.len / sizeof(int) - drop * DF_CACHE_BLOCK;
+    text_base = offset[drop * DF_CACHE_BLOCK];
+    memmove(b->text.data, b->text.data + text_base, b->text.len - text_base);
+    b->text.len -= text_base;
+    for (i = 0; i < n_lines; i++)
+	offset[i] = offset[i + drop * DF_CACHE_BLOCK] - text_base;
+    b->offsets.len = n_lines * sizeof(int);
+
+    f->cache.first_block += drop;
+}
+
+/* Is the last line read from the followed file still where it was?
+ * If not, the file has been written over rather than appended to.
+ * The text kept for the line has lost the '\r' of a DOS line end.
+ */
+static TBOOLEAN
+df_follow_same_file(struct df_follow_file *f)
+{
+    struct df_cache_builder *b = &f->parse;
+    char *last;
+    size_t len, n;
+
+    if (b->n_lines == 0)
+	return (f->end == 0);
+    last = b->text.data + ((int *) b->offsets.data)[b->offsets.len / sizeof(int) - 1];
+    len = strlen(last);
+    n = ((long) len + 2 > f->end) ? len + 1 : len + 2;
+    if ((long) n > f->end || fseek(data_fp, f->end - n, SEEK_SET) != 0)
+	return FALSE;
+    if (n > (size_t) max_line_len)
+	line = gp_realloc(line, max_line_len = n + 32, "datafile line buffer");
+    if (fread(line, 1, n, data_fp) != n || line[n - 1] != '\n')
+	return FALSE;
+    if (!memcmp(line + n - 1 - len, last, len))
+	return TRUE;
+    return (n == len + 2 && line[len] == '\r' && !memcmp(line, last, len));
+}
+
+#endif /* HAVE_SYS_STAT_H */
+
+/* Called by df_open() for ascii files.  Find or create the cache of the
+ * file and start replaying it.  Returns FALSE if the file must be read
+ * as text.
+ */
+static TBOOLEAN
+df_cache_open()
+{
+#ifdef HAVE_SYS_STAT_H
+    struct df_cache *cache = &df_cache_loaded;
+    struct stat statbuf;
+    char *key, *name;
+
+    df_cache = NULL;
+    if (!df_cache_dir || df_format
+    ||  df_stat_data(&statbuf) < 0 || !S_ISREG(statbuf.st_mode))
+	return FALSE;
+
+    key = df_cache_key();
+    if (cache->valid && cache->device == (unsigned long) statbuf.st_dev
+    &&  cache->inode == (unsigned long) statbuf.st_ino
+    &&  cache->header->source_size == (double) statbuf.st_size
+    &&  cache->header->source_mtime == df_stat_mtime(&statbuf)
+    &&  (size_t) cache->header->key_length == strlen(key)
+    &&  !memcmp(cache->image + DF_CACHE_PAD(sizeof(struct df_cache_header)),
+		key, cache->header->key_length)) {
+	/* still loaded from the last time */
+	free(key);
+	df_cache = cache;
+	df_cache_line = 0;
+	return TRUE;
+    }
+
+    name = gp_alloc(strlen(df_cache_dir) + 64, "datafile cache");
+    sprintf(name, "%s%c%lx-%lx.gpcache", df_cache_dir, DIRSEP1,
+	    (unsigned long) statbuf.st_dev, (unsigned long) statbuf.st_ino);
+    cache->valid = df_cache_read(cache, name, &statbuf, key);
+    if (!cache->valid) {
+	cache->valid = df_cache_build(cache, &statbuf, key, name);
+	rewind(data_fp);
+    }
+    cache->device = statbuf.st_dev;
+    cache->inode = statbuf.st_ino;
+    free(name);
+    free(key);
+
+    if (!cache->valid)
+	return FALSE;
+    df_cache = cache;
+    df_cache_line = 0;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/* Called by df_open() instead of df_cache_open() for a file plotted with
+ * "follow".  Parse the lines appended to the file since it was last read
+ * and start replaying all of them, or the last df_follow_last.  Returns
+ * FALSE if the file must be read as text.
+ */
+static TBOOLEAN
+df_follow_open()
+{
+#ifdef HAVE_SYS_STAT_H
+    struct df_follow_file *f;
+    struct df_cache_builder *b;
+    struct stat statbuf;
+    char *key, *data;
+    int i, n_blocks;
+
+    df_cache = NULL;
+    if (df_format || df_stat_data(&statbuf) < 0 || !S_ISREG(statbuf.st_mode))
+	return FALSE;
+#ifdef DF_DECOMPRESS
+    if (df_compressed)
+	return FALSE;
+#endif
 
-    /* Make information about whether the data forms a grid or not
-     * available to the outside world.  */
-    df_matrix = (df_matrix_file
-		 || ((df_num_bin_records == 1) 
-		     && ((df_bin_record[0].cart_dim[1] > 0)
-			 || (df_bin_record[0].scan_dim[1] > 0))));
+    for (f = df_follow_files; f; f = f->next)
+	if (!strcmp(f->filename, df_filename))
+	    break;
+    if (!f) {
+	f = gp_alloc(sizeof(struct df_follow_file), "datafile follow");
+	memset(f, 0, sizeof(struct df_follow_file));
+	f->filename = gp_strdup(df_filename);
+	f->next = df_follow_files;
+	df_follow_files = f;
+    }
+    b = &f->parse;
+
+    /* Start again if this is not the file read before, or it has been
+     * truncated, or lines that are wanted now have been let go */
+    key = df_cache_key();
+    if (f->device != (unsigned long) statbuf.st_dev
+    ||  f->inode != (unsigned long) statbuf.st_ino
+    ||  statbuf.st_size < f->end
+    ||  (statbuf.st_size == f->end && df_stat_mtime(&statbuf) != f->mtime)
+    ||  (statbuf.st_size > f->end && !df_follow_same_file(f))
+    ||  !f->key || strcmp(f->key, key)
+    ||  (f->cache.first_block > 0
+	 && (df_follow_last <= 0
+	     || b->n_lines - df_follow_last < f->cache.first_block * DF_CACHE_BLOCK))) {
+	df_cache_builder_free(b);
+	f->cache.first_block = 0;
+	f->end = 0;
+	f->device = statbuf.st_dev;
+	f->inode = statbuf.st_ino;
+    }
+    free(f->key);
+    f->key = key;
+    f->mtime = df_stat_mtime(&statbuf);
+
+    if (statbuf.st_size > f->end) {
+	if (fseek(data_fp, f->end, SEEK_SET) != 0
+	||  !df_cache_read_lines(b, &f->end)) {
+	    df_cache_builder_free(b);
+	    f->cache.first_block = 0;
+	    f->end = 0;
+	    f->key[0] = '\0';
+	    rewind(data_fp);
+	    return FALSE;
+	}
+	df_follow_trim(f, df_follow_last);
+    }
 
-    return df_no_use_specs;
+    /* Put the lines of the last block, not yet full, into columns too */
+    f->tail.len = 0;
+    if (b->rows.n_rows > 0)
+	df_cache_emit_block(&f->tail, &b->rows);
+    n_blocks = b->n_blocks - f->cache.first_block;
+    f->cache.block = gp_realloc(f->cache.block,
+		(n_blocks + 1) * sizeof(struct df_cache_block), "datafile follow");
+    data = b->blocks.data;
+    for (i = 0; i < n_blocks; i++)
+	data += df_cache_block_at(&f->cache.block[i], data);
+    if (b->rows.n_rows > 0)
+	df_cache_block_at(&f->cache.block[n_blocks], f->tail.data);
+
+    f->header.n_lines = b->n_lines;
+    f->header.n_blocks = n_blocks + (b->rows.n_rows > 0);
+    f->header.text_size = b->text.len;
+    f->cache.header = &f->header;
+    f->cache.line_offset = (int *) b->offsets.data;
+    f->cache.text = b->text.data;
+    f->cache.valid = TRUE;
+
+    df_cache = &f->cache;
+    df_cache_line = f->cache.first_block * DF_CACHE_BLOCK;
+    if (df_follow_last > 0 && df_cache_line < b->n_lines - df_follow_last)
+	df_cache_line = b->n_lines - df_follow_last;
+    return TRUE;
+#else
+    return FALSE;
+#endif
 }
 
-/*}}} */
-
-/*{{{  void df_close() */
-void
-df_close()
+/* Text of a line of the file being replayed */
+static char *
+df_cache_text(int line_no)
 {
-    int i;
-
-    /* paranoid - mark $n and column(n) as invalid */
-    df_no_cols = 0;
+    return df_cache->text
+	 + df_cache->line_offset[line_no - df_cache->first_block * DF_CACHE_BLOCK];
+}
 
-    if (!data_fp && !df_datablock)
-	return;
+/* Next line of the cached file, in place of df_gets() */
+static char *
+df_cache_gets()
+{
+    if (df_cache_line >= df_cache->header->n_lines)
+	return NULL;
+    return df_cache_text(df_cache_line++);
+}
 
-#ifdef BACKWARDS_COMPATIBLE
-    free_at(ydata_func.at);
-    ydata_func.at = NULL;
-#endif
+/* Fill in df_column[] and df_tokens[] for the line last returned by
+ * df_cache_gets(), as df_tokenise() would have done.
+ */
+static void
+df_cache_tokenise()
+{
+    int line_no = df_cache_line - 1;
+    struct df_cache_block *block =
+		&df_cache->block[line_no / DF_CACHE_BLOCK - df_cache->first_block];
+    int row = line_no % DF_CACHE_BLOCK;
+    char *text = df_cache_text(line_no);
+    int no_cols = block->no_cols[row];
+    int i, j;
+
+    for (i = 0; i < MAXDATACOLS; i++)
+	df_tokens[i] = NULL;
 
-    /* free any use expression storage */
-    for (i = 0; i < MAXDATACOLS; ++i)
-	if (use_spec[i].at) {
-	    free_at(use_spec[i].at);
-	    use_spec[i].at = NULL;
+    /* Nothing to the right of the last column used is looked at,
+     * except in the first row */
+    if (df_already_got_headers && df_last_needed_column > 0
+    &&  no_cols > df_last_needed_column)
+	no_cols = df_last_needed_column;
+    if (df_max_cols < no_cols)
+	expand_df_column(no_cols + 20);
+
+    for (j = 0; j < no_cols; j++) {
+	size_t k = (size_t) j * block->n_rows + row;
+	int start = block->start[k];
+	int where = block->where[k];
+	enum DF_STATUS good = block->good[k];
+
+	if (good == DF_STRINGDATA)
+	    df_column[j].good = good;
+	else if (good == DF_MISSING
+	     ||  df_last_needed_column == 0
+	     ||  (j < df_last_needed_column && df_column_needed[j])) {
+	    df_column[j].datum = block->datum[k];
+	    df_column[j].good = good;
+	} else {
+	    /* df_tokenise() only checks that unused fields are not empty */
+	    df_column[j].good = (where & DF_CACHE_NOT_EMPTY) ? DF_GOOD : DF_BAD;
+	    if (isnan(df_column[j].datum))
+		df_column[j].good = DF_UNDEFINED;
 	}
 
-    /* free binary matrix data */
-    if (df_matrix) {
-	for (i = 0; i < df_num_bin_records; i++) {
-	    free(df_bin_record[i].memory_data);
-	    df_bin_record[i].memory_data = NULL;
+	switch (where & ~DF_CACHE_NOT_EMPTY) {
+	case DF_CACHE_AT_START:
+	    df_column[j].position = text + start;
+	    break;
+	case DF_CACHE_AFTER_QUOTE:
+	    df_column[j].position = text + start + 1;
+	    break;
+	default:
+	    df_column[j].position = NULL;
+	    break;
 	}
-    }
 
-    if (!mixed_data_fp && !df_datablock) {
-#if defined(HAVE_FDOPEN)
-	if (data_fd == fileno(data_fp)) {
-	    /* This will allow replotting if this stream is backed by a file,
-	     * and hopefully is harmless if it connects to a pipe.
-	     * Leave it open in either case.
-	     */
-	    rewind(data_fp);
-	    fprintf(stderr,"Rewinding fd %d\n", data_fd);
-	} else
-#endif
-#if defined(PIPES)
-	if (df_pipe_open) {
-	    (void) pclose(data_fp);
-	    df_pipe_open = FALSE;
-	} else
-#endif /* PIPES */
-	    (void) fclose(data_fp);
+	if (start >= 0)
+	    for (i = 0; i < MAXDATACOLS; i++)
+		if (j == use_spec[i].column-1)
+		    df_tokens[i] = text + start;
     }
-    mixed_data_fp = FALSE;
-    data_fp = NULL;
+    df_no_cols = no_cols;
 }
 
 /*}}} */
@@ -1321,10 +3354,14 @@ df_close()
 void
 df_showdata()
 {
-  if (data_fp && df_filename && line) {
+  char *current = line;
+
+  if (df_cache)
+    current = (df_cache_line > 0) ? df_cache_text(df_cache_line - 1) : NULL;
+  if (data_fp && df_filename && current) {
     /* display no more than 77 characters */
-    fprintf(stderr, "%.77s%s\n%s:%d:", line,
-	    (strlen(line) > 77) ? "..." : "",
+    fprintf(stderr, "%.77s%s\n%s:%d:", current,
+	    (strlen(current) > 77) ? "..." : "",
 	    df_filename, df_line_number);
   }
 }
@@ -1335,7 +3372,6 @@ df_showdata()
 static void
 plot_option_every()
 {
-    fast_columns = 0;           /* corey@cac */
     /* allow empty fields - every a:b:c::e we have already established
      * the defaults */
 
@@ -1471,7 +3507,6 @@ plot_option_using(int max_using)
 		/* do not increment c+token ; let while() find the : */
 
 	    } else if (equals(c_token, "(")) {
-		fast_columns = 0;       /* corey@cac */
 		dummy_func = NULL;      /* no dummy variables active */
 		/* this will match ()'s: */
 		at_highest_column_used = NO_COLUMN_HEADER;
@@ -1503,7 +3538,6 @@ plot_option_using(int max_using)
 		use_spec[df_no_use_specs].at = create_call_column_at(column_label);
 		use_spec[df_no_use_specs++].column = NO_COLUMN_HEADER;
 		parse_1st_row_as_headers = TRUE;
-		fast_columns = 0;
 		/* FIXME - is it safe to always take the title from the 2nd use spec? */
 		if (df_no_use_specs == 2) {
 		    free(df_key_title);
@@ -1513,9 +3547,8 @@ plot_option_using(int max_using)
 	    } else {
 		int col = int_expression();
 
-		if (col == -3)	/* pseudocolumn -3 means "last column" */	
-		    fast_columns = 0;
-		else if (col < -2)
+		/* pseudocolumn -3 means "last column" */
+		if (col < -2 && col != -3)
 		    int_error(c_token, "Column must be >= -2");
 
 		use_spec[df_no_use_specs++].column = col;
@@ -1564,8 +3597,7 @@ plot_ticlabel_using(int axis)
 	use_spec[df_no_use_specs+df_no_tic_specs].at = NULL;
     } else {
 	use_spec[df_no_use_specs+df_no_tic_specs].at = perm_at();
-	fast_columns = 0;	/* Force all columns to be evaluated */
-	col = 1;		/* Redundant because of the above */
+	col = 1;		/* Not used; the expression is evaluated */
     }
 
     if (col < 1)
@@ -1615,7 +3647,7 @@ df_readascii(double v[], int max)
 	return DF_EOF;
 
 	/*{{{  process line */
-    while ((s = df_gets()) != NULL) {
+    while ((s = (df_cache ? df_cache_gets() : df_gets())) != NULL) {
 	int line_okay = 1;
 	int output = 0;         /* how many numbers written to v[] */
 
@@ -1669,6 +3701,8 @@ df_readascii(double v[], int max)
 		++df_current_index;
 		line_count = 0;
 		df_datum = -1;
+		if (df_seek)
+		    df_seek_record();
 
 		/* Found two blank lines after a block of data with a named index */
 		if (indexname && index_found) {
@@ -1745,7 +3779,9 @@ df_readascii(double v[], int max)
 
 	++df_datum;
 
-	if (df_format) {
+	if (df_datablock && df_datablock_data->binary)
+	    df_datablock_tokenise();
+	else if (df_format) {
 	    /*{{{  do a sscanf */
 	    int i;
 
@@ -1776,7 +3812,9 @@ df_readascii(double v[], int max)
 		df_column[i].position = NULL;   /* cant get a time */
 	    }
 	    /*}}} */
-	} else
+	} else if (df_cache)
+	    df_cache_tokenise();
+	else
 	    df_tokenise(s);
 
 	/* Always save the contents of the first row in case it is needed for
@@ -1989,11 +4027,14 @@ df_readascii(double v[], int max)
 			 && (axis_array[df_axis[output]].datatype == DT_TIMEDATE)) {
 		    struct tm tm;
 		    double usec = 0.0;
+		    /* A binary datablock already holds time columns in seconds */
+		    TBOOLEAN seconds = df_datablock && df_datablock_data->binary;
 		    if (column > df_no_cols ||
-			df_column[column - 1].good == DF_MISSING ||
-			!df_column[column - 1].position ||
-			!gstrptime(df_column[column - 1].position,
-				   axis_array[df_axis[output]].timefmt, &tm, &usec)
+			(seconds ? df_column[column - 1].good != DF_GOOD :
+			 (df_column[column - 1].good == DF_MISSING ||
+			  !df_column[column - 1].position ||
+			  !gstrptime(df_column[column - 1].position,
+				     axis_array[df_axis[output]].timefmt, &tm, &usec)))
 			) {
 			/* line bad only if user explicitly asked for this column */
 			if (df_no_use_specs)
@@ -2002,7 +4043,10 @@ df_readascii(double v[], int max)
 			/* return or ignore line depending on line_okay */
 			break;
 		    }
-		    v[output] = (double) gtimegm(&tm) + usec;
+		    if (seconds)
+			v[output] = df_column[column - 1].datum;
+		    else
+			v[output] = (double) gtimegm(&tm) + usec;
 
 		} else if (use_spec[output].expected_type == CT_STRING) {
 		    /* Do nothing. */
@@ -2103,11 +4147,103 @@ df_read_a_float(FILE *fin) {
     return fdummy;
 }
 
+/* Version 1 binary matrix (see binary.h).  Returns FALSE, with the file
+ * rewound, if the header is not there, i.e. for the original float format.
+ * binary.c is not part of gnuplot proper, so the header is decoded here.
+ */
+static TBOOLEAN
+df_gpbin_matrix_info(FILE *fin)
+{
+    unsigned char buf[GPBIN_HEADER_SIZE];
+    double field[3];	/* ncols, nrows, header length */
+    double data_offset;
+    int nc, nr, i, k, read_order;
+    size_t element_size;
+    df_data_type type;
+    long flength;
+
+    if (fread(buf, 1, GPBIN_HEADER_SIZE, fin) != GPBIN_HEADER_SIZE
+    ||  memcmp(buf, GPBIN_MAGIC, 4)) {
+	fseek(fin, 0L, SEEK_SET);
+	return FALSE;
+    }
+    if (buf[4] != GPBIN_VERSION)
+	int_error(NO_CARET, "Unsupported binary matrix version %d", (int)buf[4]);
+    if (buf[6] > 1 || buf[7] != 0)
+	int_error(NO_CARET, "Corrupt binary matrix header");
+
+    switch (buf[5]) {
+	case GPBIN_FLOAT32:	type = FLOAT_TEST(4);		element_size = 4; break;
+	case GPBIN_FLOAT64:	type = FLOAT_TEST(8);		element_size = 8; break;
+	case GPBIN_INT16:	type = SIGNED_TEST(2);		element_size = 2; break;
+	case GPBIN_UINT8:	type = UNSIGNED_TEST(1);	element_size = 1; break;
+	default:
+	    int_error(NO_CARET, "Unknown binary matrix element type %d", (int)buf[5]);
+	    return FALSE; /* NOT REACHED */
+    }
+
+    /* The 64-bit fields are accumulated as doubles; anything too big
+     * for a grid dimension is rejected below anyway. */
+    for (i = 0; i < 3; i++)
+	for (field[i] = 0, k = 0; k < 8; k++)
+	    field[i] = field[i] * 256 + buf[8 + 8*i + (buf[6] ? k : 7 - k)];
+    if (field[0] == 0 || field[1] == 0)
+	int_error(NO_CARET, "Read grid of zero width");
+    else if (field[0] > 1e8 || field[1] > 1e8)
+	int_error(NO_CARET, "Read grid width too large");
+    if (field[2] < GPBIN_HEADER_SIZE || field[2] > 1e8)
+	int_error(NO_CARET, "Corrupt binary matrix header");
+    nc = field[0];
+    nr = field[1];
+
+    /* The header's byte order overrides any "endian" option */
+    df_bin_file_endianess = buf[6] ? DF_BIG_ENDIAN : DF_LITTLE_ENDIAN;
+    read_order = byte_read_order(df_bin_file_endianess);
+
+    data_offset = field[2] + (field[0] + field[1]) * sizeof(double);
+    fseek(fin, 0L, SEEK_END);
+    flength = ftell(fin);
+    if (data_offset + field[0] * field[1] * element_size > flength)
+	int_error(NO_CARET, "Binary matrix file is shorter than its header says");
+
+    /* Coordinates */
+    df_matrix_xcoord = gp_realloc(df_matrix_xcoord, nc * sizeof(double), "matrix x coordinates");
+    df_matrix_ycoord = gp_realloc(df_matrix_ycoord, nr * sizeof(double), "matrix y coordinates");
+    fseek(fin, (long)field[2], SEEK_SET);
+    if (fread(df_matrix_xcoord, sizeof(double), nc, fin) != nc
+    ||  fread(df_matrix_ycoord, sizeof(double), nr, fin) != nr)
+	int_error(NO_CARET, read_error_msg);
+    for (i = 0; read_order && i < nc; i++)
+	df_swap_bytes_by_endianess((char *)&df_matrix_xcoord[i], read_order, sizeof(double));
+    for (i = 0; read_order && i < nr; i++)
+	df_swap_bytes_by_endianess((char *)&df_matrix_ycoord[i], read_order, sizeof(double));
+
+    df_matrix_corner[0][0] = df_matrix_xcoord[0];
+    df_matrix_corner[1][0] = df_matrix_xcoord[nc-1];
+    df_matrix_corner[0][1] = df_matrix_ycoord[0];
+    df_matrix_corner[1][1] = df_matrix_ycoord[nr-1];
+
+    /* The data is one contiguous uniform matrix after the coordinates. */
+    df_set_read_type(1, type);
+    df_column_bininfo[0].skip_bytes = 0;
+    df_bin_record[0].scan_skip[0] = data_offset;
+    df_bin_record[0].scan_dim[0] = nc;
+    df_bin_record[0].scan_dim[1] = nr;
+    df_matrix_coords = TRUE;
+
+    fseek(fin, 0L, SEEK_SET);
+    return TRUE;
+}
+
 void
 df_determine_matrix_info(FILE *fin)
 {
 
-    if (df_binary_file) {
+    if (df_binary_file && df_gpbin_matrix_info(fin)) {
+
+	/* Version 1 binary matrix format, all set up. */
+
+    } else if (df_binary_file) {
 
 	/* Binary matrix format. */
 	float fdummy;
@@ -2301,6 +4437,7 @@ df_reset_after_error()
 {
     reset_numeric_locale();
     evaluate_inside_using = FALSE;
+    arrow_reset();
 }
 
 void
@@ -2383,6 +4520,9 @@ f_columnhead(union argument *arg)
     if (!evaluate_inside_using)
 	int_error(c_token-1, "columnhead() called from invalid context");
 
+    if (df_datablock && df_datablock_data->binary)
+	int_error(c_token-1, "a binary datablock has no column headers");
+
     (void) arg;                 /* avoid -Wunused warning */
     (void) pop(&a);
     column_for_key_title = (int) real(&a);
@@ -2446,6 +4586,12 @@ f_timecolumn(union argument *arg)
 
     whichaxis = df_axis[current_using_spec];
 
+    if (df_datablock && df_datablock_data->binary
+	&& column >= 1 && column <= df_no_cols
+	&& df_column[column - 1].good == DF_GOOD) {
+	push(Gcomplex(&a, df_column[column - 1].datum, 0.0));
+	return;
+    }
     if (column < 1
 	|| column > df_no_cols
 	|| !df_column[column - 1].position
@@ -2599,6 +4745,8 @@ df_set_key_title(struct curve_points *plot)
 void
 df_set_key_title_columnhead(struct curve_points *plot)
 {
+    if (df_datablock && df_datablock_data->binary)
+	int_error(c_token, "a binary datablock has no column headers");
     c_token++;
     if (equals(c_token,"(")) {
 	c_token++;
@@ -2977,7 +5125,7 @@ adjust_binary_use_spec()
     /* The default binary matrix format is nonuniform, i.e. 
      * it has an extra row and column for sample coordinates.
      */
-    if (df_matrix_file && df_binary_file)
+    if (df_matrix_file && df_binary_file && !df_matrix_coords)
 	df_nonuniform_matrix = TRUE;
 
     c_token_copy = c_token;
@@ -4323,6 +6471,274 @@ df_skip_bytes(int nbytes)
 }
 
 
+#ifdef USE_MMAP
+/* Map a regular binary data file into memory.  Returns a pointer to the
+ * current file position within the map, or NULL if the input cannot be
+ * mapped (pipe, stdin, mixed input, pixel data, ...), in which case the
+ * caller keeps reading with fread().
+ */
+static char *
+df_mmap_binary()
+{
+    struct stat st;
+    long offset;
+    void *map;
+
+    if (!data_fp || mixed_data_fp || plotted_data_from_stdin || df_pixeldata)
+	return NULL;
+#ifdef DF_DECOMPRESS
+    if (df_compressed)
+	return NULL;
+#endif
+#ifdef DF_PREFETCH
+    /* "set datafile prefetch" asks for read() rather than page faults */
+    if (df_prefetched)
+	return NULL;
+#endif
+#if defined(PIPES)
+    if (df_pipe_open)
+	return NULL;
+#endif
+    if (fstat(fileno(data_fp), &st) || !S_ISREG(st.st_mode) || st.st_size <= 0
+    ||  (off_t)(size_t)st.st_size != st.st_size)
+	return NULL;
+    offset = ftell(data_fp);
+    if (offset < 0 || offset > st.st_size)
+	return NULL;
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(data_fp), 0);
+    if (map == MAP_FAILED)
+	return NULL;
+#ifdef MADV_SEQUENTIAL
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    df_mmap_base = map;
+    df_mmap_size = st.st_size;
+    df_mmap_end = df_mmap_base + df_mmap_size;
+    FPRINTF((stderr,"df_mmap_binary: mapped %ld bytes, starting at %ld\n",
+	    (long)df_mmap_size, offset));
+    return df_mmap_base + offset;
+}
+#endif
+
+
+/* Advance a pointer into in-memory binary data, without running off
+ * the end of a mapped file.
+ */
+static char *
+df_memory_skip(char *data, int nbytes)
+{
+    if (df_mmap_base && nbytes > df_mmap_end - data)
+	return df_mmap_end;
+    return data + nbytes;
+}
+
+
+/* Convert n values of one binary column, stride bytes apart, to double. */
+#define DF_DECODE(TYPE)						\
+    if (read_order == 0) {					\
+	for (k = 0; k < n; k++, src += stride) {		\
+	    TYPE val;						\
+	    memcpy(&val, src, sizeof(TYPE));			\
+	    dst[k] = val;					\
+	}							\
+    } else {							\
+	for (k = 0; k < n; k++, src += stride) {		\
+	    TYPE val;						\
+	    memcpy(buf, src, sizeof(TYPE));			\
+	    df_swap_bytes_by_endianess(buf, read_order, sizeof(TYPE)); \
+	    memcpy(&val, buf, sizeof(TYPE));			\
+	    dst[k] = val;					\
+	}							\
+    }								\
+    break;
+
+static void
+df_decode_binary_column(
+    double *dst, const char *src, int n, int stride,
+    df_data_type type, int read_order)
+{
+    char buf[sizeof(long long) > sizeof(double) ? sizeof(long long) : sizeof(double)];
+    int k;
+
+    switch (type) {
+	case DF_CHAR:		DF_DECODE(char)
+	case DF_UCHAR:		DF_DECODE(unsigned char)
+	case DF_SHORT:		DF_DECODE(short)
+	case DF_USHORT:		DF_DECODE(unsigned short)
+	case DF_INT:		DF_DECODE(int)
+	case DF_UINT:		DF_DECODE(unsigned int)
+	case DF_LONG:		DF_DECODE(long)
+	case DF_ULONG:		DF_DECODE(unsigned long)
+	case DF_LONGLONG:	DF_DECODE(long long)
+	case DF_ULONGLONG:	DF_DECODE(unsigned long long)
+	case DF_FLOAT:		DF_DECODE(float)
+	case DF_DOUBLE:		DF_DECODE(double)
+	default:
+	    int_error(NO_CARET, "Binary data type unknown");
+    }
+}
+#undef DF_DECODE
+
+
+/* Decode up to limit points (at most DF_BIN_BLOCK) of general binary
+ * data from memory into df_bin_block[], a column at a time.  Only whole
+ * points are decoded.  Advances *data past them and returns how many.
+ */
+static int
+df_read_bin_block(char **data, const char *end, int limit, int read_order)
+{
+    int i, n, offset;
+    long bytes_per_point = 0;
+
+    for (i = 0; i <= df_no_bin_cols; i++) {
+	bytes_per_point += df_column_bininfo[i].skip_bytes;
+	if (i < df_no_bin_cols)
+	    bytes_per_point += df_column_bininfo[i].column.read_size;
+    }
+
+    n = (limit < DF_BIN_BLOCK) ? limit : DF_BIN_BLOCK;
+    if ((end - *data) / bytes_per_point < n)
+	n = (end - *data) / bytes_per_point;
+    if (n <= 0)
+	return 0;
+
+    if (df_bin_block_cols < df_no_bin_cols) {
+	df_bin_block = gp_realloc(df_bin_block,
+			df_no_bin_cols * DF_BIN_BLOCK * sizeof(double),
+			"binary block");
+	df_bin_block_cols = df_no_bin_cols;
+    }
+
+    for (i = 0, offset = 0; i < df_no_bin_cols; i++) {
+	offset += df_column_bininfo[i].skip_bytes;
+	df_decode_binary_column(df_bin_block + i * DF_BIN_BLOCK, *data + offset,
+			n, bytes_per_point,
+			df_column_bininfo[i].column.read_type, read_order);
+	offset += df_column_bininfo[i].column.read_size;
+    }
+
+    *data += n * bytes_per_point;
+    return n;
+}
+
+
+/* Bytes [offset, offset+length) of a column-oriented file, from the map
+ * if there is one, otherwise read into a buffer.
+ */
+static const char *
+df_columnar_bytes(long offset, size_t length)
+{
+#ifdef USE_MMAP
+    if (df_mmap_base) {
+	if (offset < 0 || (size_t)offset > df_mmap_size
+	||  length > df_mmap_size - (size_t)offset)
+	    int_error(NO_CARET, "Data file \"%s\" is truncated", df_filename);
+	return df_mmap_base + offset;
+    }
+#endif
+    if (length > df_columnar_buffer_size) {
+	df_columnar_buffer = gp_realloc(df_columnar_buffer, length, "column buffer");
+	df_columnar_buffer_size = length;
+    }
+    if (fseek(data_fp, offset, SEEK_SET)
+    ||  fread(df_columnar_buffer, 1, length, data_fp) != length)
+	int_error(NO_CARET, "Data file \"%s\" is truncated", df_filename);
+    return df_columnar_buffer;
+}
+
+
+/* Decode up to limit rows (at most DF_BIN_BLOCK) of a column-oriented
+ * file into df_bin_block[], going on to the next batch at the end of
+ * one.  Each column is decoded straight from where it lies in the file.
+ * Returns the number of rows decoded, 0 at the end of the data.
+ */
+static int
+df_read_column_block(int limit, int read_order)
+{
+    struct df_column_batch *batch;
+    double nan = not_a_number();
+    int i, k, n;
+
+    while (df_columnar_batch < df_columnar->nbatches
+    &&     df_columnar_row >= df_columnar->batch[df_columnar_batch].rows) {
+	df_columnar_batch++;
+	df_columnar_row = 0;
+    }
+    if (df_columnar_batch >= df_columnar->nbatches)
+	return 0;
+    batch = &df_columnar->batch[df_columnar_batch];
+
+    n = (limit < DF_BIN_BLOCK) ? limit : DF_BIN_BLOCK;
+    if (batch->rows - df_columnar_row < n)
+	n = batch->rows - df_columnar_row;
+
+    if (df_bin_block_cols < df_no_bin_cols) {
+	df_bin_block = gp_realloc(df_bin_block,
+			df_no_bin_cols * DF_BIN_BLOCK * sizeof(double),
+			"binary block");
+	df_bin_block_cols = df_no_bin_cols;
+    }
+
+    for (i = 0; i < df_no_bin_cols; i++) {
+	double *dst = df_bin_block + i * DF_BIN_BLOCK;
+	int size = df_column_bininfo[i].column.read_size;
+
+	if (i >= df_columnar->ncols || batch->values[i] < 0) {
+	    for (k = 0; k < n; k++)
+		dst[k] = nan;
+	    continue;
+	}
+	df_decode_binary_column(dst,
+		df_columnar_bytes(batch->values[i] + df_columnar_row * size, n * size),
+		n, size, df_column_bininfo[i].column.read_type, read_order);
+	if (df_columnar->scale[i] != 1.0 || df_columnar->offset[i] != 0.0)
+	    for (k = 0; k < n; k++)
+		dst[k] = dst[k] * df_columnar->scale[i] + df_columnar->offset[i];
+
+	/* Null values are undefined */
+	if (batch->validity[i] >= 0) {
+	    long long first = df_columnar_row;
+	    const unsigned char *bits = (const unsigned char *)
+		df_columnar_bytes(batch->validity[i] + first / 8,
+				  (first % 8 + n + 7) / 8);
+	    for (k = 0; k < n; k++) {
+		long long bit = first % 8 + k;
+		if (!(bits[bit / 8] & (1 << (bit % 8))))
+		    dst[k] = nan;
+	    }
+	}
+    }
+
+    df_columnar_row += n;
+    return n;
+}
+
+
+/* Release the layout of a column-oriented file */
+void
+df_free_columnar()
+{
+    int i, j;
+
+    if (!df_columnar)
+	return;
+    for (i = 0; i < df_columnar->nbatches; i++) {
+	free(df_columnar->batch[i].values);
+	free(df_columnar->batch[i].validity);
+    }
+    free(df_columnar->batch);
+    for (j = 0; j < df_columnar->ncols; j++)
+	free(df_columnar->names[j]);
+    free(df_columnar->names);
+    free(df_columnar->scale);
+    free(df_columnar->offset);
+    free(df_columnar);
+    df_columnar = NULL;
+}
+
+
 /*{{{  int df_readbinary(v, max) */
 /* do the hard work... read lines from file,
  * - use blanks to get index number
@@ -4346,6 +6762,7 @@ df_readbinary(double v[], int max)
     static int end_of_block;
     static TBOOLEAN translation_required;
     static char *memory_data;
+    static TBOOLEAN block_decode;
 
     /* For matrix data structure (i.e., gnuplot binary). */
     static double first_matrix_column;
@@ -4485,8 +6902,35 @@ df_readbinary(double v[], int max)
 	for (i = 0; i < 3; i++)
 	    translation_required = translation_required || (c[i] != o[i]);
 
-	/* Should data come from memory? */
-	memory_data = this_record->memory_data;
+	/* Should data come from memory?  A mapped file is read on from
+	 * wherever the previous record ended. */
+	if (this_record->memory_data)
+	    memory_data = this_record->memory_data;
+#ifdef USE_MMAP
+	else if (df_bin_record_count == 0 && df_binary_file)
+	    memory_data = df_mmap_binary();
+	else if (df_mmap_base)
+	    ;
+#endif
+	else
+	    memory_data = NULL;
+
+	/* General binary read from a mapped file is decoded in blocks,
+	 * and so is a column-oriented file in any case. */
+	block_decode = (df_mmap_base && memory_data && !df_matrix_file)
+		    || df_columnar != NULL;
+	df_bin_block_count = df_bin_block_next = 0;
+	if (df_columnar) {
+	    df_columnar_batch = 0;
+	    df_columnar_row = 0;
+	    if (df_max_cols < df_columnar->ncols)
+		expand_df_column(df_columnar->ncols);
+	    for (i = 0; i < df_columnar->ncols; i++) {
+		free(df_column[i].header);
+		df_column[i].header = df_columnar->names[i]
+				    ? gp_strdup(df_columnar->names[i]) : NULL;
+	    }
+	}
 
 	/* byte read order */
 	read_order = byte_read_order(df_bin_file_endianess);
@@ -4504,7 +6948,7 @@ df_readbinary(double v[], int max)
 	 * Don't apply this to ascii input or special filetypes.
 	 * Slurp all data from file or pipe in one shot to minimize fread calls.
 	 */
-	if (!memory_data && !(df_bin_filetype > 0)
+	if ((!memory_data || df_mmap_base) && !(df_bin_filetype > 0)
 	&&  df_binary_file &&  df_matrix && !df_nonuniform_matrix) {
 	    int i;
 	    unsigned long int bytes_per_point = 0;
@@ -4513,12 +6957,18 @@ df_readbinary(double v[], int max)
 	    unsigned long int bytes_total = 0;
 	    size_t fread_ret;
 
-	    /* Accumulate total number of bytes in this tuple */
+	    /* Accumulate total number of bytes in this tuple.
+	     * A matrix file holds a single value per point. */
+	    if (df_matrix_file)
+		bytes_per_point = df_column_bininfo[0].skip_bytes
+				+ df_column_bininfo[0].column.read_size;
+	    else {
 	    for (i=0; i<df_no_bin_cols; i++)
 		bytes_per_point +=  
 		  df_column_bininfo[i].skip_bytes +
 		  df_column_bininfo[i].column.read_size;
 	    bytes_per_point += df_column_bininfo[df_no_bin_cols].skip_bytes;
+	    }
 	  
 	    bytes_per_line  = bytes_per_point
 			    * (  (scan_size[0] > 0) ? scan_size[0] : 1 );
@@ -4528,17 +6978,24 @@ df_readbinary(double v[], int max)
 			    * ( (scan_size[2]>0) ? scan_size[2] : 1);
 	    bytes_total    += record_skip;
 
+	    FPRINTF((stderr,"Fast matrix code:\n"));
+	    FPRINTF((stderr,"\t\t skip %d bytes, read %ld bytes as %d x %d array\n",
+		    record_skip, bytes_total, scan_size[0], scan_size[1]));
+
+	    /* A mapped file needs no copy, only a check that it is long enough */
+	    if (df_mmap_base)
+		fread_ret = (df_mmap_end - memory_data < bytes_total)
+			  ? df_mmap_end - memory_data : bytes_total;
+	    else
+	    {
 	    /* Allocate a chunk of memory and stuff it */
 	    /* EAM FIXME: Is this a leak if the plot errors out? */
 	    memory_data = gp_alloc(bytes_total, "df_readbinary slurper");
 	    this_record->memory_data = memory_data; 
 	 
-	    FPRINTF((stderr,"Fast matrix code:\n"));
-	    FPRINTF((stderr,"\t\t skip %d bytes, read %ld bytes as %d x %d array\n",
-		    record_skip, bytes_total, scan_size[0], scan_size[1]));
- 
 	    /* Do the actual slurping */
 	    fread_ret = fread(memory_data, 1, bytes_total, data_fp);
+	    }
 	    if (fread_ret != bytes_total) {
 		int_warn(NO_CARET, "Couldn't slurp %ld bytes (return was %zd)\n",
 			bytes_total, fread_ret);
@@ -4590,103 +7047,133 @@ df_readbinary(double v[], int max)
 	/* Possibly skip bytes before starting to read record. */
 	if (record_skip) {
 	    if (memory_data)
-		memory_data += record_skip;
+		memory_data = df_memory_skip(memory_data, record_skip);
 	    else if (df_skip_bytes(record_skip))
 		return DF_EOF;
 	    record_skip = 0;
 	}
 
-	/* Bring in variables as described by the field parameters.
-	 * If less than than the appropriate number of bytes have been
-	 * read, issue an error stating not enough columns were found.  */
-	for (i = 0; ; i++) {
-	    int skip_bytes = df_column_bininfo[i].skip_bytes;
+	if (block_decode) {
+	    /* Hand out the next point of the decoded block, refilling
+	     * it with at most the rest of the current scan line. */
+	    if (df_bin_block_next >= df_bin_block_count) {
+		int limit = (scan_size[0] > 0) ? scan_size[0] - df_M_count : DF_BIN_BLOCK;
 
-	    if (skip_bytes) {
-		if (memory_data)
-		    memory_data += skip_bytes;
-		else if (df_skip_bytes(skip_bytes))
+		df_bin_block_next = 0;
+		if (df_columnar)
+		    df_bin_block_count = df_read_column_block(limit, read_order);
+		else
+		    df_bin_block_count = df_read_bin_block(&memory_data, df_mmap_end,
+							limit, read_order);
+		if (df_bin_block_count == 0) {
+		    df_eof = 1;
 		    return DF_EOF;
+		}
+	    }
+	    for (i = 0; i < df_no_bin_cols; i++) {
+		df_column[i].datum = df_bin_block[i * DF_BIN_BLOCK + df_bin_block_next];
+		df_column[i].good = DF_GOOD;
+		df_column[i].position = NULL;
 	    }
+	    df_bin_block_next++;
+	} else {
+	    /* Bring in variables as described by the field parameters.
+	     * If less than than the appropriate number of bytes have been
+	     * read, issue an error stating not enough columns were found.  */
+	    for (i = 0; ; i++) {
+		int skip_bytes = df_column_bininfo[i].skip_bytes;
+
+		if (skip_bytes) {
+		    if (memory_data)
+			memory_data = df_memory_skip(memory_data, skip_bytes);
+		    else if (df_skip_bytes(skip_bytes))
+			return DF_EOF;
+		}
 
-	    /* Last entry only has skip bytes, no data. */
-	    if (i == df_no_bin_cols)
-		break;
+		/* Last entry only has skip bytes, no data. */
+		if (i == df_no_bin_cols)
+		    break;
 
-	    /* Read in a "column", i.e., a binary value of various types. */
-	    if (df_pixeldata) {
-		io_val.uc = df_libgd_get_pixel(df_M_count, df_N_count, i);
-	    } else
+		/* Read in a "column", i.e., a binary value of various types. */
+		if (df_pixeldata) {
+		    io_val.uc = df_libgd_get_pixel(df_M_count, df_N_count, i);
+		} else
 
-	    if (memory_data) {
-		for (fread_ret = 0;
-		     fread_ret < df_column_bininfo[i].column.read_size;
-		     fread_ret++)
-		    (&io_val.ch)[fread_ret] = *memory_data++;
-	    } else {
-		fread_ret = fread(&io_val.ch,
-				  df_column_bininfo[i].column.read_size,
-				  1, data_fp);
-		if (fread_ret != 1) {
-		    df_eof = 1;
-		    return DF_EOF;
+		if (memory_data) {
+		    if (df_mmap_base
+		    &&  df_mmap_end - memory_data < df_column_bininfo[i].column.read_size) {
+			df_eof = 1;
+			return DF_EOF;
+		    }
+		    for (fread_ret = 0;
+			 fread_ret < df_column_bininfo[i].column.read_size;
+			 fread_ret++)
+			(&io_val.ch)[fread_ret] = *memory_data++;
+		} else {
+		    fread_ret = fread(&io_val.ch,
+				      df_column_bininfo[i].column.read_size,
+				      1, data_fp);
+		    if (fread_ret != 1) {
+			df_eof = 1;
+			return DF_EOF;
+		    }
 		}
-	    }
 
-	    if (read_order != 0)
-		df_swap_bytes_by_endianess(&io_val.ch, read_order,
-				       df_column_bininfo[i].column.read_size);
+		if (read_order != 0)
+		    df_swap_bytes_by_endianess(&io_val.ch, read_order,
+					   df_column_bininfo[i].column.read_size);
 
-	    switch (df_column_bininfo[i].column.read_type) {
-		case DF_CHAR:
-		    df_column[i].datum = io_val.ch;
-		    break;
-		case DF_UCHAR:
-		    df_column[i].datum = io_val.uc;
-		    break;
-		case DF_SHORT:
-		    df_column[i].datum = io_val.sh;
-		    break;
-		case DF_USHORT:
-		    df_column[i].datum = io_val.us;
-		    break;
-		case DF_INT:
-		    df_column[i].datum = io_val.in;
-		    break;
-		case DF_UINT:
-		    df_column[i].datum = io_val.ui;
-		    break;
-		case DF_LONG:
-		    df_column[i].datum = io_val.lo;
-		    break;
-		case DF_ULONG:
-		    df_column[i].datum = io_val.ul;
-		    break;
-		case DF_LONGLONG:
-		    df_column[i].datum = io_val.llo;
-		    break;
-		case DF_ULONGLONG:
-		    df_column[i].datum = io_val.ull;
-		    break;
-		case DF_FLOAT:
-		    df_column[i].datum = io_val.fl;
-		    break;
-		case DF_DOUBLE:
-		    df_column[i].datum = io_val.db;
-		    break;
-		default:
-		    int_error(NO_CARET, "Binary data type unknown");
-	    }
+		switch (df_column_bininfo[i].column.read_type) {
+		    case DF_CHAR:
+			df_column[i].datum = io_val.ch;
+			break;
+		    case DF_UCHAR:
+			df_column[i].datum = io_val.uc;
+			break;
+		    case DF_SHORT:
+			df_column[i].datum = io_val.sh;
+			break;
+		    case DF_USHORT:
+			df_column[i].datum = io_val.us;
+			break;
+		    case DF_INT:
+			df_column[i].datum = io_val.in;
+			break;
+		    case DF_UINT:
+			df_column[i].datum = io_val.ui;
+			break;
+		    case DF_LONG:
+			df_column[i].datum = io_val.lo;
+			break;
+		    case DF_ULONG:
+			df_column[i].datum = io_val.ul;
+			break;
+		    case DF_LONGLONG:
+			df_column[i].datum = io_val.llo;
+			break;
+		    case DF_ULONGLONG:
+			df_column[i].datum = io_val.ull;
+			break;
+		    case DF_FLOAT:
+			df_column[i].datum = io_val.fl;
+			break;
+		    case DF_DOUBLE:
+			df_column[i].datum = io_val.db;
+			break;
+		    default:
+			int_error(NO_CARET, "Binary data type unknown");
+		}
 
-	    df_column[i].good = DF_GOOD;
-	    df_column[i].position = NULL;   /* cant get a time */
+		df_column[i].good = DF_GOOD;
+		df_column[i].position = NULL;   /* cant get a time */
 
-	    /* Matrix file data is a special case. After reading in just
-	     * one binary value, stop and decide on what to do with it. */
-	    if (df_matrix_file)
-		break;
+		/* Matrix file data is a special case. After reading in just
+		 * one binary value, stop and decide on what to do with it. */
+		if (df_matrix_file)
+		    break;
 
-	} /* for(i) */
+	    } /* for(i) */
+	}
 
 	if (df_matrix_file) {
 	    if (df_nonuniform_matrix) {
@@ -4731,9 +7218,13 @@ df_readbinary(double v[], int max)
 		 * overwritten. */
 		for (j = df_no_bin_cols-1; j >= 0; j--) {
 		    if (j == 0)
-			df_column[j].datum = df_nonuniform_matrix ? scanned_matrix_row[df_M_count] : df_M_count;
+			df_column[j].datum = df_nonuniform_matrix ? scanned_matrix_row[df_M_count]
+					   : df_matrix_coords ? df_matrix_xcoord[df_M_count]
+					   : df_M_count;
 		    else if (j == 1)
-			df_column[j].datum = df_nonuniform_matrix ? first_matrix_column : df_N_count;
+			df_column[j].datum = df_nonuniform_matrix ? first_matrix_column
+					   : df_matrix_coords ? df_matrix_ycoord[df_N_count]
+					   : df_N_count;
 		    else
 			df_column[j].datum = df_column[i].datum;
 		    df_column[j].good = DF_GOOD;
@@ -117,6 +117,13 @@ extern TBOOLEAN df_fortran_constants;
 /* handler before every expression evaluation in a using specifier.   	 */
 /* This can speed data input significantly, but assumes valid input.    */
 extern TBOOLEAN df_nofpe_trap;
+
+/* Directory holding cached parses of ascii data files, NULL if none */
+extern char *df_cache_dir;
+
+/* Number of buffers read ahead by a second thread, 0 to read directly */
+extern int df_prefetch_depth;
+
 extern TBOOLEAN evaluate_inside_using;
 extern TBOOLEAN df_warn_on_missing_columnheader;
 
@@ -256,6 +263,25 @@ typedef struct df_binary_file_record_struct {
 
 extern df_binary_file_record_struct *df_bin_record;
 extern int df_num_bin_records;
+
+/* Column-oriented binary files (filetype=arrow).  The file type function
+ * records where the values of each column start in each batch of rows,
+ * and df_readbinary() decodes them from there a block at a time.
+ */
+typedef struct df_column_layout {
+    int ncols;
+    char **names;		/* column names, may be NULL */
+    double *scale;		/* decoded values are multiplied by scale */
+    double *offset;		/* and offset is added (time units) */
+    int nbatches;
+    struct df_column_batch {
+	long long rows;
+	long *values;		/* file offset of each column, -1 if unreadable */
+	long *validity;		/* file offset of its null bitmap, -1 if none */
+    } *batch;
+} df_column_layout;
+
+extern df_column_layout *df_columnar;
 extern struct coordinate blank_data_line;
 
 extern struct use_spec_s use_spec[];
@@ -276,5 +302,6 @@ df_data_type df_get_read_type __PROTO((int col));                     /* Type of
 int df_get_read_size __PROTO((int col));                              /* Size of data in the binary column. */
 int df_get_num_matrix_cols __PROTO((void));
 void df_set_plot_mode __PROTO((int));
+void df_free_columnar __PROTO((void));
 
 #endif /* GNUPLOT_DATAFILE_H */
@@ -54,6 +54,9 @@ static char *RCSid() { return RCSid("$Id: eval.c,v 1.113 2013/11/16 05:07:49 sfe
 
 #include <signal.h>
 #include <setjmp.h>
+#ifdef PARALLEL_SAMPLING
+# include <pthread.h>
+#endif
 
 /* Internal prototypes */
 static RETSIGTYPE fpe __PROTO((int an_int));
@@ -67,14 +70,14 @@ struct udft_entry *first_udf = NULL;
 /* pointer to first udv users can delete */
 struct udvt_entry **udv_user_head;
 
-TBOOLEAN undefined;
+GP_THREAD_LOCAL TBOOLEAN undefined;
 
 /* The stack this operates on */
-static struct value stack[STACK_DEPTH];
-static int s_p = -1;		/* stack pointer */
+static GP_THREAD_LOCAL struct value stack[STACK_DEPTH];
+static GP_THREAD_LOCAL int s_p = -1;		/* stack pointer */
 #define top_of_stack stack[s_p]
 
-static int jump_offset;		/* to be modified by 'jump' operators */
+static GP_THREAD_LOCAL int jump_offset;	/* to be modified by 'jump' operators */
 
 /* The table of built-in functions */
 /* These must strictly parallel enum operators in eval.h */
@@ -691,6 +694,325 @@ free_at(struct at_type *at_ptr)
     free(at_ptr);
 }
 
+/*
+ * Parallel sampling of functions ('set samples ... threads <N>').
+ *
+ * Every worker thread evaluates its share of the sample points on private
+ * copies of the action tables involved.  The dummy variables of the
+ * plotted function and of all user functions it calls, as well as the
+ * user variables it reads, therefore belong to the thread.  The stack,
+ * the jump offset, the recursion depth and 'undefined' are thread-local.
+ * Expressions with side effects or that refer to the data being read are
+ * not sampled in parallel.  An error or warning inside a worker ends that
+ * thread; the caller then evaluates all points serially, which reports
+ * the problem in the usual way.
+ */
+#ifdef PARALLEL_SAMPLING
+
+#define SAMPLE_CHUNK 64		/* points handed to a worker at a time */
+
+struct sample_map {
+    void *orig;
+    void *copy;
+};
+
+struct sample_job {
+    int n_points;
+    const double *dummy0;
+    const double *dummy1;
+    struct sample_value *result;
+    int next;			/* first point not yet handed out */
+    TBOOLEAN failed;
+    pthread_mutex_t lock;
+};
+
+struct sample_worker {
+    struct sample_job *job;
+    pthread_t thread;
+    struct udft_entry *func;	/* private copy of the sampled function */
+    struct sample_map *udf;	/* copies of user functions ... */
+    int n_udf, max_udf;
+    struct sample_map *udv;	/* ... and of user variables */
+    int n_udv, max_udv;
+};
+
+static GP_THREAD_LOCAL struct sample_worker *sample_worker = NULL;
+
+static TBOOLEAN sample_safe_operator __PROTO((int operator));
+static void *sample_lookup __PROTO((struct sample_map **map, int *n, int *max, void *orig, size_t size));
+static struct udft_entry *sample_copy_udf __PROTO((struct sample_worker *w, struct udft_entry *udf));
+static void sample_free_copies __PROTO((struct sample_worker *w));
+static void *sample_thread __PROTO((void *arg));
+
+/* Operators that change global state, use static buffers, or that only
+ * make sense while a data file is read, keep an expression in the main
+ * thread.  lgamma() sets the global signgam, and the cephes routines
+ * report errors through mtherr(), which writes a static and stdout.
+ */
+static TBOOLEAN
+sample_safe_operator(int operator)
+{
+    FUNC_PTR func = ft[operator].func;
+
+    if (operator == SUM)
+	return TRUE;
+    if (func == NULL
+    ||  func == f_dollars || func == f_assign
+    ||  func == f_column || func == f_stringcolumn || func == f_columnhead
+    ||  func == f_valid || func == f_timecolumn
+    ||  func == f_rand || func == f_system || func == f_time
+    ||  func == f_sprintf || func == f_gprintf || func == f_words
+    ||  func == f_strftime || func == f_strptime
+    ||  func == f_exists || func == f_value
+    ||  func == f_gamma || func == f_lgamma
+    ||  func == f_ibeta || func == f_igamma
+    ||  func == f_inverse_normal)
+	return FALSE;
+#ifndef HAVE_ERFC
+    if (func == f_erf || func == f_erfc || func == f_normal)
+	return FALSE;
+#endif
+    return TRUE;
+}
+
+/* Return the copy of orig in map, creating it if necessary.  The copy
+ * starts out as a byte copy of the original.
+ */
+static void *
+sample_lookup(
+    struct sample_map **map, int *n, int *max,
+    void *orig, size_t size)
+{
+    int i;
+
+    for (i = 0; i < *n; i++)
+	if ((*map)[i].orig == orig)
+	    return (*map)[i].copy;
+    if (*n >= *max) {
+	*max = *max ? 2 * *max : 16;
+	*map = gp_realloc(*map, *max * sizeof(struct sample_map), "sample map");
+    }
+    (*map)[*n].orig = orig;
+    (*map)[*n].copy = gp_alloc(size, "sample copy");
+    memcpy((*map)[*n].copy, orig, size);
+    return (*map)[(*n)++].copy;
+}
+
+/* Copy a user function and, recursively, everything its action table
+ * refers to.  Returns NULL if the function cannot be sampled in parallel.
+ */
+static struct udft_entry *
+sample_copy_udf(struct sample_worker *w, struct udft_entry *udf)
+{
+    struct udft_entry *copy;
+    struct at_type *at;
+    size_t len;
+    int n = w->n_udf;
+    int i;
+
+    copy = sample_lookup(&w->udf, &w->n_udf, &w->max_udf, udf, sizeof(*udf));
+    if (w->n_udf == n)		/* already copied */
+	return copy;
+    for (i = 0; i < MAX_NUM_VAR; i++)
+	(void) Ginteger(&copy->dummy_values[i], 0);
+    if (!udf->at) {
+	copy->at = NULL;
+	return NULL;
+    }
+
+    len = sizeof(struct at_type)
+	+ (udf->at->a_count - MAX_AT_LEN) * sizeof(struct at_entry);
+    at = gp_alloc(len, "sample action table");
+    memcpy(at, udf->at, len);
+    copy->at = at;
+
+    for (i = 0; i < at->a_count; i++) {
+	union argument *arg = &at->actions[i].arg;
+	int operator = at->actions[i].index;
+
+	if (!sample_safe_operator(operator))
+	    return NULL;
+	switch (operator) {
+	case PUSH:
+	    arg->udv_arg = sample_lookup(&w->udv, &w->n_udv, &w->max_udv,
+				arg->udv_arg, sizeof(struct udvt_entry));
+	    break;
+	case PUSHD1:
+	case PUSHD2:
+	case PUSHD:
+	case CALL:
+	case CALLN:
+	case SUM:
+	    if (!(arg->udf_arg = sample_copy_udf(w, arg->udf_arg)))
+		return NULL;
+	    break;
+	default:
+	    break;
+	}
+    }
+    return copy;
+}
+
+static void
+sample_free_copies(struct sample_worker *w)
+{
+    int i;
+
+    /* String constants and names are shared with the originals */
+    for (i = 0; i < w->n_udf; i++) {
+	free(((struct udft_entry *)w->udf[i].copy)->at);
+	free(w->udf[i].copy);
+    }
+    for (i = 0; i < w->n_udv; i++)
+	free(w->udv[i].copy);
+    free(w->udf);
+    free(w->udv);
+}
+
+static void *
+sample_thread(void *arg)
+{
+    struct sample_worker *w = arg;
+    struct sample_job *job = w->job;
+    int first, last, i;
+
+    sample_worker = w;
+    for (;;) {
+	pthread_mutex_lock(&job->lock);
+	first = job->next;
+	job->next += SAMPLE_CHUNK;
+	if (job->failed)
+	    first = job->n_points;
+	pthread_mutex_unlock(&job->lock);
+	if (first >= job->n_points)
+	    break;
+	last = GPMIN(first + SAMPLE_CHUNK, job->n_points);
+
+	for (i = first; i < last; i++) {
+	    struct sample_value *r = &job->result[i];
+
+	    (void) Gcomplex(&w->func->dummy_values[0], job->dummy0[i], 0.0);
+	    if (job->dummy1)
+		(void) Gcomplex(&w->func->dummy_values[1], job->dummy1[i], 0.0);
+
+	    /* Same as evaluate_at(), without the SIGFPE handler.  The only */
+	    /* operations that trap, integer / and %, check their operands. */
+	    undefined = FALSE;
+	    errno = 0;
+	    s_p = -1;
+	    execute_at(w->func->at);
+	    if (errno == EDOM || errno == ERANGE)
+		undefined = TRUE;
+	    else if (!undefined) {
+		(void) pop(&r->val);
+		check_stack();
+		if (r->val.type == STRING)
+		    sample_worker_error();
+	    }
+	    r->undefined = undefined;
+	}
+    }
+    return NULL;
+}
+
+#endif /* PARALLEL_SAMPLING */
+
+/* Called on entry to int_error() and int_warn().  Inside a sampling
+ * thread it abandons the parallel evaluation instead.
+ */
+void
+sample_worker_error()
+{
+#ifdef PARALLEL_SAMPLING
+    if (sample_worker) {
+	struct sample_job *job = sample_worker->job;
+
+	pthread_mutex_lock(&job->lock);
+	job->failed = TRUE;
+	pthread_mutex_unlock(&job->lock);
+	pthread_exit(NULL);
+    }
+#endif
+}
+
+/* The iteration variable of sum [] is looked up by name */
+struct udvt_entry *
+sample_private_udv(struct udvt_entry *udv)
+{
+#ifdef PARALLEL_SAMPLING
+    if (sample_worker)
+	return sample_lookup(&sample_worker->udv, &sample_worker->n_udv,
+			&sample_worker->max_udv, udv, sizeof(struct udvt_entry));
+#endif
+    return udv;
+}
+
+/* Evaluate the function udf of one or two dummy variables at n_points
+ * points using up to n_threads threads.  Returns an array of results that
+ * the caller must free, or NULL if the points have to be evaluated
+ * serially with evaluate_at().
+ */
+struct sample_value *
+sample_function(
+    struct udft_entry *udf,
+    int n_points,
+    const double *dummy0, const double *dummy1,
+    int n_threads)
+{
+#ifdef PARALLEL_SAMPLING
+    struct sample_job job;
+    struct sample_worker *worker;
+    sigset_t all, old;
+    int i, started;
+
+    if (n_threads < 2 || n_points < 2 * SAMPLE_CHUNK || evaluate_inside_using)
+	return NULL;
+    n_threads = GPMIN(n_threads, (n_points + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK);
+
+    job.n_points = n_points;
+    job.dummy0 = dummy0;
+    job.dummy1 = dummy1;
+    job.result = gp_alloc(n_points * sizeof(struct sample_value), "samples");
+    job.next = 0;
+    job.failed = FALSE;
+    pthread_mutex_init(&job.lock, NULL);
+
+    worker = gp_alloc(n_threads * sizeof(struct sample_worker), "sample threads");
+    memset(worker, 0, n_threads * sizeof(struct sample_worker));
+    for (i = 0; i < n_threads; i++) {
+	worker[i].job = &job;
+	if (!(worker[i].func = sample_copy_udf(&worker[i], udf)))
+	    job.failed = TRUE;
+    }
+
+    /* Signals, SIGINT and SIGFPE included, are for the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (started = 0; started < n_threads && !job.failed; started++)
+	if (pthread_create(&worker[started].thread, NULL, sample_thread, &worker[started]))
+	    break;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (started == 0)
+	job.failed = TRUE;
+    for (i = 0; i < started; i++)
+	pthread_join(worker[i].thread, NULL);
+
+    for (i = 0; i < n_threads; i++)
+	sample_free_copies(&worker[i]);
+    free(worker);
+    pthread_mutex_destroy(&job.lock);
+
+    if (job.failed) {
+	free(job.result);
+	return NULL;
+    }
+    return job.result;
+#else
+    (void) udf; (void) n_points; (void) dummy0; (void) dummy1; (void) n_threads;
+    return NULL;
+#endif
+}
+
 /* EAM July 2003 - Return pointer to udv with this name; if the key does not
  * match any existing udv names, create a new one and return a pointer to it.
  */
@@ -916,6 +1238,7 @@ update_gpval_variables(int context)
 	fill_gpval_float("GPVAL_VIEW_ROT_Z", surface_rot_z);
 	fill_gpval_float("GPVAL_VIEW_SCALE", surface_scale);
 	fill_gpval_float("GPVAL_VIEW_ZSCALE", surface_zscale);
+	fill_gpval_integer("GPVAL_TERM_ELIDED", (int)term_state_elided);
 	return;
     }
 
@@ -119,6 +119,12 @@ struct at_type {
 };
 
 
+/* A function value computed by sample_function() */
+struct sample_value {
+    struct value val;
+    TBOOLEAN undefined;
+};
+
 /* Variables of eval.c needed by other modules: */
 
 extern const struct ft_entry GPFAR ft[]; /* The table of builtin functions */
@@ -127,7 +133,7 @@ extern struct udvt_entry *first_udv; /* user-def'd variables */
 extern struct udvt_entry udv_pi; /* 'pi' variable */
 extern struct udvt_entry *udv_NaN; /* 'NaN' variable */
 extern struct udvt_entry **udv_user_head; /* first udv that can be deleted */
-extern TBOOLEAN undefined;
+extern GP_THREAD_LOCAL TBOOLEAN undefined;
 
 /* Prototypes of functions exported by eval.c */
 
@@ -161,6 +167,10 @@ void f_jtern __PROTO((union argument *x));
 void execute_at __PROTO((struct at_type *at_ptr));
 void evaluate_at __PROTO((struct at_type *at_ptr, struct value *val_ptr));
 void free_at __PROTO((struct at_type *at_ptr));
+struct sample_value *sample_function __PROTO((struct udft_entry *udf, int n_points,
+				const double *dummy0, const double *dummy1, int n_threads));
+void sample_worker_error __PROTO((void));
+struct udvt_entry *sample_private_udv __PROTO((struct udvt_entry *udv));
 struct udvt_entry * add_udv_by_name __PROTO((char *key));
 struct udvt_entry * get_udv_by_name __PROTO((char *key));
 void del_udv_by_name __PROTO(( char *key, TBOOLEAN isWildcard ));
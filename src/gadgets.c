@@ -93,6 +93,11 @@ t_position tmargin = DEFAULT_MARGIN_POSITION;
 /* File descriptor for output during 'set table' mode */
 FILE *table_outfile = NULL;
 TBOOLEAN table_mode = FALSE;
+/* Datablock for output by 'set table $name {binary}', else NULL.
+ * A text table is collected in table_outfile, a temporary file.
+ */
+struct udvt_entry *table_var = NULL;
+TBOOLEAN table_binary = FALSE;
 
 /* Pointer to the start of the linked list of 'set label' definitions */
 struct text_label *first_label = NULL;
@@ -152,6 +157,7 @@ static int clip_line __PROTO((int *, int *, int *, int *));
 /* set samples */
 int samples_1 = SAMPLES;
 int samples_2 = SAMPLES;
+int sample_threads = 1;		/* threads used to sample functions */
 
 /* set angles */
 double ang2rad = 1.0;		/* 1 or pi/180, tracking angles_format */
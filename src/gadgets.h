@@ -408,6 +408,8 @@ extern t_position lmargin, bmargin, rmargin, tmargin;
 
 extern FILE *table_outfile;
 extern TBOOLEAN table_mode;
+extern struct udvt_entry *table_var;
+extern TBOOLEAN table_binary;
 
 extern struct arrow_def *first_arrow;
 
@@ -466,6 +468,7 @@ extern TBOOLEAN	clip_points;
 #define SAMPLES 100		/* default number of samples for a plot */
 extern int samples_1;
 extern int samples_2;
+extern int sample_threads;
 
 extern double ang2rad; /* 1 or pi/180 */
 
@@ -42,6 +42,28 @@ static void CMY_2_RGB __PROTO((rgb_color *color));
 static void CIEXYZ_2_RGB __PROTO((rgb_color *color));
 static void YIQ_2_RGB __PROTO((rgb_color *color));
 static void HSV_2_RGB __PROTO((rgb_color *color));
+static TBOOLEAN palette_lut_matches __PROTO((void));
+static TBOOLEAN palette_lut_usable __PROTO((void));
+static void rgb1_from_palette_lut __PROTO((double gray, rgb_color *color));
+static char *palette_lut_strdup __PROTO((const char *s));
+
+/*
+ * Cached gray --> rgb table for the current palette.
+ * For palettes defined by user functions rgb1_from_gray() runs the
+ * expression interpreter three times per color, and terminals call it
+ * once per pm3d quadrangle or image pixel.  The table holds
+ * PALETTE_LUT_SIZE colors at equally spaced gray values and is linearly
+ * interpolated, which is an approximation:  colors between the nodes
+ * may differ from direct evaluation by a unit in the last 8-bit place,
+ * and a discontinuity of the functions is smeared over 1/4095 in gray.
+ * It is rebuilt whenever sm_palette is not exactly the palette it was
+ * built from, and also by invalidate_palette_lut() since the functions
+ * may depend on user variables.
+ */
+#define PALETTE_LUT_SIZE 4096
+static rgb_color *palette_lut = NULL;
+static t_sm_palette palette_lut_palette;	/* private copy of the palette */
+static TBOOLEAN palette_lut_valid = FALSE;
 
 
 /* check if two palettes p1 and p2 differ significantly */
@@ -102,7 +124,11 @@ palettes_differ(t_sm_palette *p1, t_sm_palette *p2)
 	}
 	break;
     case SMPAL_COLOR_MODE_CUBEHELIX:
-	return 1;
+	if (p1->gamma != p2->gamma
+	||  p1->cubehelix_start != p2->cubehelix_start
+	||  p1->cubehelix_cycles != p2->cubehelix_cycles
+	||  p1->cubehelix_saturation != p2->cubehelix_saturation)
+	    return 1;
 	break;
     } /* case GRADIENT */
     } /* switch() */
@@ -339,6 +365,10 @@ rgb1maxcolors_from_gray(double gray, rgb_color *color)
 {
     if (sm_palette.use_maxcolors != 0)
 	gray = quantize_gray(gray);
+    else if (palette_lut_usable()) {
+	rgb1_from_palette_lut(gray, color);
+	return;
+    }
 
     rgb1_from_gray(gray, color);
 }
@@ -400,6 +430,133 @@ rgb255maxcolors_from_gray(double gray, rgb255_color *rgb255)
 }
 
 
+/*
+ *  Same as rgb255maxcolors_from_gray() for a whole array of gray values,
+ *  e.g. all pixels of an image.  The palette is checked only once.
+ *  NaN gray values are mapped as gray = 0;  callers that treat them
+ *  specially must test the input themselves.
+ */
+void
+rgb255maxcolors_from_gray_array(const coordval *gray, int n, rgb255_color *rgb255)
+{
+    int i;
+    rgb_color rgb1;
+
+    if (sm_palette.use_maxcolors != 0 || !palette_lut_usable()) {
+	for (i = 0; i < n; i++)
+	    rgb255maxcolors_from_gray(isnan(gray[i]) ? 0 : gray[i], &rgb255[i]);
+	return;
+    }
+
+    for (i = 0; i < n; i++) {
+	rgb1_from_palette_lut(gray[i], &rgb1);
+	rgb255_from_rgb1(rgb1, &rgb255[i]);
+    }
+}
+
+
+/*
+ *  Force the next lookup to rebuild the gray --> rgb table.
+ */
+void
+invalidate_palette_lut()
+{
+    palette_lut_valid = FALSE;
+}
+
+
+/* getcolor.c is also linked into gnuplot_x11, which lacks gp_strdup() */
+static char *
+palette_lut_strdup(const char *s)
+{
+    char *copy;
+
+    if (!s)
+	s = "";
+    copy = malloc(strlen(s) + 1);
+    strcpy(copy, s);
+    return copy;
+}
+
+/*
+ *  Exact comparison of sm_palette with the palette the table was built
+ *  from.  palettes_differ() tolerates small changes, which would leave
+ *  a stale table in place.
+ */
+static TBOOLEAN
+palette_lut_matches()
+{
+    return sm_palette.colorMode == palette_lut_palette.colorMode
+	&& sm_palette.positive == palette_lut_palette.positive
+	&& sm_palette.cmodel == palette_lut_palette.cmodel
+	&& !strcmp(sm_palette.Afunc.definition, palette_lut_palette.Afunc.definition)
+	&& !strcmp(sm_palette.Bfunc.definition, palette_lut_palette.Bfunc.definition)
+	&& !strcmp(sm_palette.Cfunc.definition, palette_lut_palette.Cfunc.definition);
+}
+
+/*
+ *  Make sure the lookup table matches sm_palette, rebuilding it if needed.
+ *  Only palettes defined by user functions are tabulated, since each
+ *  color costs three evaluations by the expression interpreter.  The
+ *  built-in palettes are cheap enough to evaluate exactly, and the table
+ *  would change their colors by interpolation, e.g. round the default
+ *  rgbformulae 7,5,15 differently or blur the steps of a gradient.
+ */
+static TBOOLEAN
+palette_lut_usable()
+{
+    int i;
+
+    if (sm_palette.colorMode != SMPAL_COLOR_MODE_FUNCTIONS)
+	return FALSE;
+
+    if (palette_lut_valid && palette_lut_matches())
+	return TRUE;
+
+    /* Keep a private copy of the things palette_lut_matches() looks at */
+    free(palette_lut_palette.Afunc.definition);
+    free(palette_lut_palette.Bfunc.definition);
+    free(palette_lut_palette.Cfunc.definition);
+    palette_lut_palette.colorMode = sm_palette.colorMode;
+    palette_lut_palette.positive = sm_palette.positive;
+    palette_lut_palette.cmodel = sm_palette.cmodel;
+    palette_lut_palette.Afunc.definition = palette_lut_strdup(sm_palette.Afunc.definition);
+    palette_lut_palette.Bfunc.definition = palette_lut_strdup(sm_palette.Bfunc.definition);
+    palette_lut_palette.Cfunc.definition = palette_lut_strdup(sm_palette.Cfunc.definition);
+
+    if (!palette_lut)
+	palette_lut = malloc(PALETTE_LUT_SIZE * sizeof(rgb_color));
+    for (i = 0; i < PALETTE_LUT_SIZE; i++)
+	rgb1_from_gray((double)i / (PALETTE_LUT_SIZE - 1), &palette_lut[i]);
+
+    palette_lut_valid = TRUE;
+    return TRUE;
+}
+
+static void
+rgb1_from_palette_lut(double gray, rgb_color *color)
+{
+    double pos, f;
+    int i;
+
+    if (!(gray > 0))	/* also catches NaN */
+	gray = 0;
+    else if (gray > 1)
+	gray = 1;
+
+    pos = gray * (PALETTE_LUT_SIZE - 1);
+    i = (int)pos;
+    if (i >= PALETTE_LUT_SIZE - 1) {
+	*color = palette_lut[PALETTE_LUT_SIZE - 1];
+	return;
+    }
+    f = pos - i;
+    color->r = palette_lut[i].r + f * (palette_lut[i+1].r - palette_lut[i].r);
+    color->g = palette_lut[i].g + f * (palette_lut[i+1].g - palette_lut[i].g);
+    color->b = palette_lut[i].b + f * (palette_lut[i+1].b - palette_lut[i].b);
+}
+
+
 /*
  *  Used by approximate_palette
  */
@@ -41,6 +41,10 @@ void rgb255_from_rgb1 __PROTO(( rgb_color rgb1, rgb255_color *rgb255 ));
 /* main gray --> rgb color mapping as above, with take care of palette maxcolors */
 void rgb1maxcolors_from_gray __PROTO(( double gray, rgb_color *color ));
 void rgb255maxcolors_from_gray __PROTO(( double gray, rgb255_color *rgb255 ));
+/* the same for an array of gray values, e.g. all pixels of an image */
+void rgb255maxcolors_from_gray_array __PROTO(( const coordval *gray, int n, rgb255_color *rgb255 ));
+/* force the cached gray --> rgb table to be rebuilt */
+void invalidate_palette_lut __PROTO(( void ));
 double quantize_gray __PROTO(( double gray ));
 
 /* HSV --> RGB user-visible function hsv2rgb(h,s,v) */
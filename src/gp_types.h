@@ -142,7 +142,7 @@ typedef struct value {
 	int int_val;
 	struct cmplx cmplx_val;
 	char *string_val;
-	char **data_array;
+	struct datablock *data_array;
     } v;
 } t_value;
 
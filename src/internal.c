@@ -74,7 +74,7 @@ static enum DATA_TYPES sprintf_specifier __PROTO((const char *format));
 
 #define BAD_DEFAULT default: int_error(NO_CARET, "internal error : type neither INT or CMPLX"); return;
 
-static int recursion_depth = 0;
+static GP_THREAD_LOCAL int recursion_depth = 0;
 void
 eval_reset_after_error()
 {
@@ -245,6 +245,7 @@ f_sum(union argument *arg)
     udv = get_udv_by_name(varname.v.string_val);
     if (!udv)
         int_error(NO_CARET, "internal error: f_sum could not access iteration variable.");
+    udv = sample_private_udv(udv);
     udv->udv_undef = false;
 
     udf = arg->udf_arg;
@@ -802,7 +803,11 @@ f_div(union argument *arg)
     case INTGR:
 	switch (b.type) {
 	case INTGR:
-	    if (b.v.int_val)
+	    /* INT_MIN / -1 overflows, which traps like division by zero */
+	    if (b.v.int_val == -1 && a.v.int_val == INT_MIN) {
+		(void) Ginteger(&result, 0);
+		undefined = TRUE;
+	    } else if (b.v.int_val)
 		(void) Ginteger(&result, a.v.int_val /
 				b.v.int_val);
 	    else {
@@ -881,7 +886,9 @@ f_mod(union argument *arg)
 
     if (a.type != INTGR || b.type != INTGR)
 	int_error(NO_CARET, "non-integer operand for %%");
-    if (b.v.int_val)
+    if (b.v.int_val == -1)	/* INT_MIN % -1 would trap */
+	push(Ginteger(&a, 0));
+    else if (b.v.int_val)
 	push(Ginteger(&a, a.v.int_val % b.v.int_val));
     else {
 	push(Ginteger(&a, 0));
@@ -179,9 +179,16 @@ typedef double five_diag[5];
 
 static int next_curve __PROTO((struct curve_points * plot, int *curve_start));
 static int num_curves __PROTO((struct curve_points * plot));
-static void eval_kdensity __PROTO((struct curve_points *cp, 
-				   int first_point, int num_points, double sr,
-				   coordval *px, coordval *py));
+static int kdensity_compare __PROTO((SORTFUNC_ARGS arg1, SORTFUNC_ARGS arg2));
+static void eval_kdensity_exact __PROTO((struct coordinate GPHUGE *this_points,
+				   int num_points, double bandwidth,
+				   const double *x, double *y));
+static void eval_kdensity_sweep __PROTO((struct coordinate GPHUGE *this_points,
+				   int num_points, double bandwidth,
+				   const double *x, double *y));
+static TBOOLEAN eval_kdensity_binned __PROTO((struct coordinate GPHUGE *this_points,
+				   int num_points, double bandwidth,
+				   double min, double max, double *y));
 static void do_kdensity __PROTO((struct curve_points *cp, int first_point,
 				 int num_points, struct coordinate *dest));
 static double *cp_binomial __PROTO((int points));
@@ -195,6 +202,14 @@ static spline_coeff *cp_tridiag __PROTO((struct curve_points * plot, int first_p
 static void do_cubic __PROTO((struct curve_points * plot, spline_coeff * sc, int first_point, int num_points, struct coordinate * dest));
 static void do_freq __PROTO((struct curve_points *plot,	int first_point, int num_points));
 int compare_points __PROTO((SORTFUNC_ARGS p1, SORTFUNC_ARGS p2));
+static int compare_sort_keys __PROTO((SORTFUNC_ARGS arg1, SORTFUNC_ARGS arg2));
+static TBOOLEAN points_are_sorted __PROTO((struct coordinate GPHUGE *points, int num_points));
+static void permute_points __PROTO((struct coordinate GPHUGE *points, int num_points, const int *order));
+static void sort_curve __PROTO((struct coordinate GPHUGE *points, int num_points));
+static void drop_cached_order __PROTO((int i));
+static unsigned long hash_values __PROTO((unsigned long h, unsigned long mult, struct coordinate GPHUGE *points, int num_points, TBOOLEAN all));
+static void drop_cached_spline __PROTO((int i));
+static spline_coeff *cached_spline __PROTO((struct curve_points *plot, int first_point, int num_points, TBOOLEAN *uncached));
 
 
 /*
@@ -256,64 +271,172 @@ num_curves(struct curve_points *plot)
    curves, except for the way the actual interpolation is generated.
 */
 
-/* eval_kdensity is a modification of eval_bezier */
-static void 
-eval_kdensity ( 
-    struct curve_points *cp,
-    int first_point,	/* where to start in plot->points (to find x-range) */
-    int num_points,	/* to determine end in plot->points */
-    double sr,		/* position inside curve, range [0:1] */
-    coordval *px,	/* OUTPUT: x and y */
-    coordval *py ) {
+/* Beyond this many bandwidths the Gaussian kernel is treated as zero
+ * by the fast evaluation methods;  exp(-0.5*8*8) is about 1e-14.
+ */
+#define KDENSITY_CUTOFF 8.0
+/* Inputs for which num_points * samples is below this are summed exactly */
+#define KDENSITY_EXACT_LIMIT 1.0e6
+/* Grid cells per bandwidth used by the binned method, and its grid size limit */
+#define KDENSITY_BINS_PER_BANDWIDTH 64
+#define KDENSITY_MAX_BINS (1<<20)
+
+struct kdensity_point {
+    double x, y;
+};
 
-    unsigned int i;
-    unsigned int n = num_points - 1;
-    struct coordinate GPHUGE *this_points = (cp->points) + first_point;
-  
-    double x, y, tmp;
-    double avg, sigma;
-    double min =  DBL_MAX;
-    double max = -DBL_MAX;
-    double bandwidth, default_bandwidth;
+static int
+kdensity_compare(SORTFUNC_ARGS arg1, SORTFUNC_ARGS arg2)
+{
+    const struct kdensity_point *p1 = arg1;
+    const struct kdensity_point *p2 = arg2;
 
-    avg = 0.0;
-    sigma = 0.0;
-    for (i = 0; i <= n; i++) {
-      avg   += this_points[i].x;
-      sigma += this_points[i].x * this_points[i].x;
+    if (p1->x > p2->x)
+	return 1;
+    if (p1->x < p2->x)
+	return -1;
+    return 0;
+}
 
-      /* Find min and max of x-range. Necessary since points not sorted! */
-      min = this_points[i].x < min ? this_points[i].x : min;
-      max = this_points[i].x > max ? this_points[i].x : max;
+/* Direct summation over all points for each of the samples_1 output
+ * positions x[i].  Cost is O(num_points * samples).
+ */
+static void
+eval_kdensity_exact(
+    struct coordinate GPHUGE *this_points,
+    int num_points,
+    double bandwidth,
+    const double *x,		/* sample positions */
+    double *y)			/* OUTPUT: density at x[] */
+{
+    int i, j;
+    double tmp;
+
+    for (j = 0; j < samples_1; j++) {
+	y[j] = 0;
+	for (i = 0; i < num_points; i++) {
+	    tmp = ( x[j] - this_points[i].x )/bandwidth;
+	    y[j] += this_points[i].y * exp( - 0.5*tmp*tmp ) / bandwidth;
+	}
+	y[j] /= sqrt(2.0*M_PI);
     }
-    avg /= (double)num_points;
-    sigma = sqrt( sigma/(double)num_points - avg*avg ); /* Standard Deviation */
-    
-    /* This is the optimal bandwidth if the point distribution is Gaussian.
-       (Applied Smoothing Techniques for Data Analysis
-       by Adrian W, Bowman & Adelchi Azzalini (1997)) */
-    /* If the supplied bandwidth is zero of less, the default bandwidth is used. */
-    default_bandwidth = pow( 4.0/(3.0*num_points), 1.0/5.0 )*sigma;
-    if (cp->smooth_parameter <= 0) {
-	bandwidth = default_bandwidth;
-	cp->smooth_parameter = -default_bandwidth;
-    } else
-	bandwidth = cp->smooth_parameter;
+}
 
-    x = min + sr*(max-min); /* The current x-value */
+/* Sort the points once, then sweep a window of width +/- KDENSITY_CUTOFF
+ * bandwidths along with the (increasing) sample positions, so that each
+ * output sums only over the points that contribute to it.
+ */
+static void
+eval_kdensity_sweep(
+    struct coordinate GPHUGE *this_points,
+    int num_points,
+    double bandwidth,
+    const double *x,
+    double *y)
+{
+    struct kdensity_point *sorted;
+    double cut = KDENSITY_CUTOFF * bandwidth;
+    double tmp;
+    int i, j, lo, hi;
+
+    sorted = gp_alloc(num_points * sizeof(*sorted), "kdensity");
+    for (i = 0; i < num_points; i++) {
+	sorted[i].x = this_points[i].x;
+	sorted[i].y = this_points[i].y;
+    }
+    qsort(sorted, num_points, sizeof(*sorted), kdensity_compare);
+
+    lo = hi = 0;
+    for (j = 0; j < samples_1; j++) {
+	while (lo < num_points && sorted[lo].x < x[j] - cut)
+	    lo++;
+	if (hi < lo)
+	    hi = lo;
+	while (hi < num_points && sorted[hi].x <= x[j] + cut)
+	    hi++;
+	y[j] = 0;
+	for (i = lo; i < hi; i++) {
+	    tmp = ( x[j] - sorted[i].x )/bandwidth;
+	    y[j] += sorted[i].y * exp( - 0.5*tmp*tmp );
+	}
+	y[j] /= bandwidth * sqrt(2.0*M_PI);
+    }
 
-    y = 0;
-    for (i = 0; i <= n; i++) {
-      tmp = ( x - this_points[i].x )/bandwidth;
-      y += this_points[i].y * exp( - 0.5*tmp*tmp ) / bandwidth;
+    free(sorted);
+}
+
+/* Linear binning onto a grid of at least KDENSITY_BINS_PER_BANDWIDTH cells
+ * per bandwidth, chosen so that every sample position falls on a grid
+ * node.  The binned weights are then convolved with a tabulated kernel.
+ * Cost is O(num_points + samples * KDENSITY_CUTOFF * KDENSITY_BINS_PER_BANDWIDTH).
+ * The relative error from binning is of order 1/(8*BINS_PER_BANDWIDTH^2),
+ * i.e. a few parts in 1e5, well below what is visible in a plot; the
+ * check in demo/kdensity_check.dem measures it against exact summation.
+ * Returns FALSE without doing anything if the grid would be too large,
+ * that is if the bandwidth is tiny compared to the x range.
+ */
+static TBOOLEAN
+eval_kdensity_binned(
+    struct coordinate GPHUGE *this_points,
+    int num_points,
+    double bandwidth,
+    double min, double max,
+    double *y)
+{
+    double step = (max - min) / (double)(samples_1 - 1);
+    double delta, *grid, *kernel;
+    int ratio, nbins, width;
+    int i, j, k;
+
+    ratio = (int)ceil(step * KDENSITY_BINS_PER_BANDWIDTH / bandwidth);
+    if (ratio < 1)
+	ratio = 1;
+    if ((double)ratio * (samples_1 - 1) + 1 > KDENSITY_MAX_BINS)
+	return FALSE;
+    nbins = ratio * (samples_1 - 1) + 1;
+    delta = step / ratio;
+    width = (int)(KDENSITY_CUTOFF * bandwidth / delta);
+
+    grid = gp_alloc(nbins * sizeof(double), "kdensity");
+    kernel = gp_alloc((width + 1) * sizeof(double), "kdensity");
+    memset(grid, 0, nbins * sizeof(double));
+
+    for (i = 0; i < num_points; i++) {
+	double pos = (this_points[i].x - min) / delta;
+	double frac;
+	k = (int)pos;
+	if (k >= nbins - 1) {
+	    grid[nbins - 1] += this_points[i].y;
+	    continue;
+	}
+	if (k < 0)
+	    k = 0;
+	frac = pos - k;
+	grid[k]   += this_points[i].y * (1.0 - frac);
+	grid[k+1] += this_points[i].y * frac;
+    }
+
+    for (k = 0; k <= width; k++) {
+	double tmp = k * delta / bandwidth;
+	kernel[k] = exp( - 0.5*tmp*tmp );
+    }
+
+    for (j = 0; j < samples_1; j++) {
+	int center = j * ratio;
+	int first = GPMAX(0, center - width);
+	int last = GPMIN(nbins - 1, center + width);
+	double sum = 0;
+	for (k = first; k <= last; k++)
+	    sum += grid[k] * kernel[abs(k - center)];
+	y[j] = sum / (bandwidth * sqrt(2.0*M_PI));
     }
-    y /= sqrt(2.0*M_PI);
 
-    *px = x;
-    *py = y;
+    free(kernel);
+    free(grid);
+    return TRUE;
 }
 
-/* do_kdensity is based on do_bezier, except for the call to eval_bezier */
+/* do_kdensity is based on do_bezier, except for the evaluation */
 static void 
 do_kdensity( 
     struct curve_points *cp,
@@ -323,6 +446,12 @@ do_kdensity(
 {
     int i;
     coordval x, y;
+    struct coordinate GPHUGE *this_points = (cp->points) + first_point;
+    double avg, sigma;
+    double min =  DBL_MAX;
+    double max = -DBL_MAX;
+    double bandwidth, default_bandwidth;
+    double *kx, *ky;
 
     /* min and max in internal (eg logged) co-ordinates. We update
      * these, then update the external extrema in user co-ordinates
@@ -340,10 +469,50 @@ do_kdensity(
     iymin = symin = AXIS_LOG_VALUE(y_axis, Y_AXIS.min);
     iymax = symax = AXIS_LOG_VALUE(y_axis, Y_AXIS.max);
 
+    avg = 0.0;
+    sigma = 0.0;
+    for (i = 0; i < num_points; i++) {
+      avg   += this_points[i].x;
+      sigma += this_points[i].x * this_points[i].x;
+
+      /* Find min and max of x-range. Necessary since points not sorted! */
+      min = this_points[i].x < min ? this_points[i].x : min;
+      max = this_points[i].x > max ? this_points[i].x : max;
+    }
+    avg /= (double)num_points;
+    sigma = sqrt( sigma/(double)num_points - avg*avg ); /* Standard Deviation */
+    
+    /* This is the optimal bandwidth if the point distribution is Gaussian.
+       (Applied Smoothing Techniques for Data Analysis
+       by Adrian W, Bowman & Adelchi Azzalini (1997)) */
+    /* If the supplied bandwidth is zero of less, the default bandwidth is used. */
+    default_bandwidth = pow( 4.0/(3.0*num_points), 1.0/5.0 )*sigma;
+    if (cp->smooth_parameter <= 0) {
+	bandwidth = default_bandwidth;
+	cp->smooth_parameter = -default_bandwidth;
+    } else
+	bandwidth = cp->smooth_parameter;
+
+    kx = gp_alloc(2 * samples_1 * sizeof(double), "kdensity");
+    ky = kx + samples_1;
+    for (i = 0; i < samples_1; i++) {
+	double sr = (double) i / (double) (samples_1 - 1);
+	kx[i] = min + sr*(max-min); /* The current x-value */
+    }
+
+    /* Small inputs and degenerate cases are summed exactly.  Otherwise
+     * bin the points if the grid is of reasonable size, which in turn
+     * means the bandwidth is not too narrow for the sweep to be slow.
+     */
+    if ((double)num_points * samples_1 <= KDENSITY_EXACT_LIMIT
+    ||  !(bandwidth > 0) || !(max > min) || samples_1 < 2)
+	eval_kdensity_exact(this_points, num_points, bandwidth, kx, ky);
+    else if (!eval_kdensity_binned(this_points, num_points, bandwidth, min, max, ky))
+	eval_kdensity_sweep(this_points, num_points, bandwidth, kx, ky);
+
     for (i = 0; i < samples_1; i++) {
-        eval_kdensity( cp, first_point, num_points,
-		       (double) i / (double) (samples_1 - 1),
-		       &x, &y );
+	x = kx[i];
+	y = ky[i];
 
 	/* now we have to store the points and adjust the ranges */
 	dest[i].type = INRANGE;
@@ -358,6 +527,8 @@ do_kdensity(
 	dest[i].z = -1;
     }
 
+    free(kx);
+
     UPDATE_RANGE(ixmax > sxmax, X_AXIS.max, ixmax, x_axis);
     UPDATE_RANGE(ixmin < sxmin, X_AXIS.min, ixmin, x_axis);
     UPDATE_RANGE(iymax > symax, Y_AXIS.max, iymax, y_axis);
@@ -414,10 +585,24 @@ cp_binomial(int points)
 }
 
 
+/* Terms of the Bernstein sum smaller than this fraction of the largest
+ * one are dropped;  they cannot change the result in double precision.
+ */
+#define BEZIER_CUTOFF 1.0e-20
+
 /* This is a subfunction of do_bezier() for BEZIER style computations.
  * It is passed the stepration (STEP/MAXSTEPS) and the addresses of
  * the double values holding the next x and y coordinates.
  * (MGR 1992)
+ *
+ * The Bernstein polynomials B(n,i)(sr) are unimodal in i with a peak
+ * near i = sr*(n+1).  Only that peak term is evaluated from the
+ * logarithmic binomial coefficients;  the neighbours on either side
+ * follow from the ratio B(n,i+1)/B(n,i) = (n-i)/(i+1) * sr/(1-sr),
+ * and the walk stops once the terms have fallen below BEZIER_CUTOFF
+ * times the peak.  This needs a single exp() per sample and touches
+ * only O(sqrt(n)) points, so that even curves with millions of points
+ * are smoothed quickly.
  */
 
 static void
@@ -447,15 +632,30 @@ eval_bezier(
 	 * out each other, anyway, in an exact calculation
 	 */
 	unsigned int i;
-	double lx = 0.0, ly = 0.0;
-	double log_dsr_to_the_n = n * log(1 - sr);
-	double log_sr_over_dsr = log(sr) - log(1 - sr);
-
-	for (i = 0; i <= n; i++) {
-	    double u = exp(c[i] + log_dsr_to_the_n + i * log_sr_over_dsr);
-
-	    lx += this_points[i].x * u;
-	    ly += this_points[i].y * u;
+	unsigned int mode = (unsigned int)(sr * (n + 1));
+	double lx, ly;
+	double peak, u;
+	double sr_over_dsr = sr / (1 - sr);
+
+	if (mode > n)
+	    mode = n;
+	peak = exp(c[mode] + mode * log(sr) + (n - mode) * log(1 - sr));
+	lx = this_points[mode].x * peak;
+	ly = this_points[mode].y * peak;
+
+	for (u = peak, i = mode; i < n; i++) {
+	    u *= sr_over_dsr * (double)(n - i) / (double)(i + 1);
+	    if (u < BEZIER_CUTOFF * peak)
+		break;
+	    lx += this_points[i + 1].x * u;
+	    ly += this_points[i + 1].y * u;
+	}
+	for (u = peak, i = mode; i > 0; i--) {
+	    u *= (double)i / ((double)(n - i + 1) * sr_over_dsr);
+	    if (u < BEZIER_CUTOFF * peak)
+		break;
+	    lx += this_points[i - 1].x * u;
+	    ly += this_points[i - 1].y * u;
 	}
 
 	*px = lx;
@@ -1049,6 +1249,93 @@ gen_interp_frequency(struct curve_points *plot)
     return;
 }
 
+/*
+ * Spline coefficients depend only on the (sorted, averaged) input points
+ * and on the log scaling of the axes, not on the current axis range or on
+ * the number of samples.  Keep those of the last few curves so that
+ * replotting unchanged data, e.g. after zooming, only evaluates them.
+ * Curves are recognized by two independent hashes of their x, y and z.
+ * The spline cache and the sort order cache below each hold at most
+ * SMOOTH_CACHE_BYTES, so that huge curves are not kept for the session.
+ */
+#define SPLINE_CACHE_SIZE 4
+#define SMOOTH_CACHE_BYTES (16*1024*1024)
+static struct {
+    enum PLOT_SMOOTH smooth;
+    int num_points;
+    double xbase, ybase;	/* log base, or 0 for linear axes */
+    unsigned long hash1, hash2;
+    spline_coeff *sc;
+} spline_cache[SPLINE_CACHE_SIZE];
+static int spline_cache_next = 0;
+static size_t spline_cache_bytes = 0;
+
+static void
+drop_cached_spline(int i)
+{
+    if (spline_cache[i].sc)
+	spline_cache_bytes -= spline_cache[i].num_points * sizeof(spline_coeff);
+    free(spline_cache[i].sc);
+    spline_cache[i].sc = NULL;
+}
+
+/* Returns the coefficients of the curve.  They belong to the cache
+ * unless *uncached is set on return, when the caller must free them.
+ */
+
+static spline_coeff *
+cached_spline(struct curve_points *plot, int first_point, int num_points, TBOOLEAN *uncached)
+{
+    struct coordinate GPHUGE *this_points = plot->points + first_point;
+    double xbase = axis_array[plot->x_axis].log ? axis_array[plot->x_axis].base : 0;
+    double ybase = axis_array[plot->y_axis].log ? axis_array[plot->y_axis].base : 0;
+    size_t bytes = num_points * sizeof(spline_coeff);
+    unsigned long hash1, hash2;
+    spline_coeff *sc;
+    int i;
+
+    *uncached = FALSE;
+    hash1 = hash_values(2166136261UL, 16777619UL, this_points, num_points, TRUE);
+    hash2 = hash_values(0x9e3779b9UL, 0x85ebca6bUL, this_points, num_points, TRUE);
+
+    for (i = 0; i < SPLINE_CACHE_SIZE; i++) {
+	if (spline_cache[i].sc
+	&&  spline_cache[i].smooth == plot->plot_smooth
+	&&  spline_cache[i].num_points == num_points
+	&&  spline_cache[i].xbase == xbase && spline_cache[i].ybase == ybase
+	&&  spline_cache[i].hash1 == hash1 && spline_cache[i].hash2 == hash2)
+	    return spline_cache[i].sc;
+    }
+
+    if (plot->plot_smooth == SMOOTH_ACSPLINES)
+	sc = cp_approx_spline(plot, first_point, num_points);
+    else
+	sc = cp_tridiag(plot, first_point, num_points);
+
+    if (bytes > SMOOTH_CACHE_BYTES) {
+	*uncached = TRUE;
+	return sc;
+    }
+
+    /* Replace the oldest entry, and more of them if needed to make room */
+    i = spline_cache_next;
+    spline_cache_next = (spline_cache_next + 1) % SPLINE_CACHE_SIZE;
+    drop_cached_spline(i);
+    while (spline_cache_bytes + bytes > SMOOTH_CACHE_BYTES) {
+	drop_cached_spline(spline_cache_next);
+	spline_cache_next = (spline_cache_next + 1) % SPLINE_CACHE_SIZE;
+    }
+    spline_cache_bytes += bytes;
+    spline_cache[i].sc = sc;
+    spline_cache[i].smooth = plot->plot_smooth;
+    spline_cache[i].num_points = num_points;
+    spline_cache[i].xbase = xbase;
+    spline_cache[i].ybase = ybase;
+    spline_cache[i].hash1 = hash1;
+    spline_cache[i].hash2 = hash2;
+    return sc;
+}
+
 /*
  * This is the shared entry point used for the original smoothing options
  * csplines acsplines bezier sbezier
@@ -1059,6 +1346,7 @@ gen_interp(struct curve_points *plot)
 {
 
     spline_coeff *sc;
+    TBOOLEAN uncached;
     double *bc;
     struct coordinate *new_points;
     int i, curves;
@@ -1073,16 +1361,12 @@ gen_interp(struct curve_points *plot)
 	num_points = next_curve(plot, &first_point);
 	switch (plot->plot_smooth) {
 	case SMOOTH_CSPLINES:
-	    sc = cp_tridiag(plot, first_point, num_points);
-	    do_cubic(plot, sc, first_point, num_points,
-		     new_points + i * (samples_1 + 1));
-	    free(sc);
-	    break;
 	case SMOOTH_ACSPLINES:
-	    sc = cp_approx_spline(plot, first_point, num_points);
+	    sc = cached_spline(plot, first_point, num_points, &uncached);
 	    do_cubic(plot, sc, first_point, num_points,
 		     new_points + i * (samples_1 + 1));
-	    free(sc);
+	    if (uncached)
+		free(sc);
 	    break;
 
 	case SMOOTH_BEZIER:
@@ -1138,6 +1422,172 @@ compare_points(SORTFUNC_ARGS arg1, SORTFUNC_ARGS arg2)
     return (0);
 }
 
+/*
+ * Data that is smoothed is very often already sorted on x, and a replot
+ * (e.g. after zooming) reads the same data again.  So sort_points() first
+ * checks for sorted input, then tries the order found for the previous
+ * curve with the same number of points and the same x values, and only
+ * then sorts.  Sorting is done on (x, index) keys rather than on the
+ * much larger coordinate structures, which are moved once at the end.
+ * Ties keep their input order.
+ */
+struct sort_key {
+    double x;
+    int index;
+};
+
+#define SORT_CACHE_SIZE 4
+static struct {
+    int num_points;
+    unsigned long hash;
+    int *order;
+} sort_cache[SORT_CACHE_SIZE];
+static int sort_cache_next = 0;
+static size_t sort_cache_bytes = 0;
+
+static void
+drop_cached_order(int i)
+{
+    if (sort_cache[i].order)
+	sort_cache_bytes -= sort_cache[i].num_points * sizeof(int);
+    free(sort_cache[i].order);
+    sort_cache[i].order = NULL;
+}
+
+static int
+compare_sort_keys(SORTFUNC_ARGS arg1, SORTFUNC_ARGS arg2)
+{
+    struct sort_key const *k1 = arg1;
+    struct sort_key const *k2 = arg2;
+
+    if (k1->x > k2->x)
+	return (1);
+    if (k1->x < k2->x)
+	return (-1);
+    return (k1->index - k2->index);
+}
+
+static TBOOLEAN
+points_are_sorted(struct coordinate GPHUGE *points, int num_points)
+{
+    int i;
+
+    for (i = 1; i < num_points; i++)
+	if (points[i].x < points[i-1].x)
+	    return FALSE;
+    return TRUE;
+}
+
+/* Rearrange points so that points[i] becomes the old points[order[i]].
+ * The permutation is applied cycle by cycle in place.
+ */
+static void
+permute_points(struct coordinate GPHUGE *points, int num_points, const int *order)
+{
+    char *done = gp_alloc(num_points, "sort flags");
+    struct coordinate tmp;
+    int i, j, k;
+
+    memset(done, 0, num_points);
+    for (i = 0; i < num_points; i++) {
+	if (done[i])
+	    continue;
+	tmp = points[i];
+	for (j = i; ; j = k) {
+	    done[j] = 1;
+	    k = order[j];
+	    if (k == i) {
+		points[j] = tmp;
+		break;
+	    }
+	    points[j] = points[k];
+	}
+    }
+    free(done);
+}
+
+/* Fold the x values (or all of x, y and z) of a curve into a hash value */
+static unsigned long
+hash_values(
+    unsigned long h, unsigned long mult,
+    struct coordinate GPHUGE *points, int num_points,
+    TBOOLEAN all)
+{
+    union {
+	double d;
+	unsigned int w[sizeof(double) / sizeof(unsigned int)];
+    } u;
+    int i, j;
+    size_t n;
+
+    for (i = 0; i < num_points; i++) {
+	for (j = 0; j < (all ? 3 : 1); j++) {
+	    u.d = (j == 0) ? points[i].x : (j == 1) ? points[i].y : points[i].z;
+	    for (n = 0; n < sizeof(u.w) / sizeof(u.w[0]); n++) {
+		h = (h ^ u.w[n]) * mult;
+		h ^= h >> 15;
+	    }
+	}
+    }
+    return h;
+}
+
+static void
+sort_curve(struct coordinate GPHUGE *points, int num_points)
+{
+    struct sort_key *keys;
+    unsigned long hash;
+    int *order;
+    int i;
+
+    if (num_points < 2 || points_are_sorted(points, num_points))
+	return;
+
+    hash = hash_values(2166136261UL, 16777619UL, points, num_points, FALSE);
+    for (i = 0; i < SORT_CACHE_SIZE; i++) {
+	if (sort_cache[i].order && sort_cache[i].num_points == num_points
+	&&  sort_cache[i].hash == hash) {
+	    permute_points(points, num_points, sort_cache[i].order);
+	    /* Any order that leaves the points sorted is a valid one */
+	    if (points_are_sorted(points, num_points))
+		return;
+	    hash = hash_values(2166136261UL, 16777619UL, points, num_points, FALSE);
+	    break;
+	}
+    }
+
+    keys = gp_alloc(num_points * sizeof(struct sort_key), "sort keys");
+    for (i = 0; i < num_points; i++) {
+	keys[i].x = points[i].x;
+	keys[i].index = i;
+    }
+    qsort(keys, num_points, sizeof(struct sort_key), compare_sort_keys);
+
+    order = gp_alloc(num_points * sizeof(int), "sort order");
+    for (i = 0; i < num_points; i++)
+	order[i] = keys[i].index;
+    free(keys);
+    permute_points(points, num_points, order);
+
+    if (num_points * sizeof(int) > SMOOTH_CACHE_BYTES) {
+	free(order);
+	return;
+    }
+
+    /* Replace the oldest entry, and more of them if needed to make room */
+    i = sort_cache_next;
+    sort_cache_next = (sort_cache_next + 1) % SORT_CACHE_SIZE;
+    drop_cached_order(i);
+    while (sort_cache_bytes + num_points * sizeof(int) > SMOOTH_CACHE_BYTES) {
+	drop_cached_order(sort_cache_next);
+	sort_cache_next = (sort_cache_next + 1) % SORT_CACHE_SIZE;
+    }
+    sort_cache_bytes += num_points * sizeof(int);
+    sort_cache[i].order = order;
+    sort_cache[i].num_points = num_points;
+    sort_cache[i].hash = hash;
+}
+
 void
 sort_points(struct curve_points *plot)
 {
@@ -1145,11 +1595,7 @@ sort_points(struct curve_points *plot)
 
     first_point = 0;
     while ((num_points = next_curve(plot, &first_point)) > 0) {
-	/* Sort this set of points, does qsort handle 1 point correctly? */
-	/* HBB 20010720: removed casts -- they don't help a thing, but
-	 * may hide problems */
-	qsort(plot->points + first_point, num_points,
-	      sizeof(struct coordinate), compare_points);
+	sort_curve(plot->points + first_point, num_points);
 	first_point += num_points;
     }
     return;
@@ -530,6 +530,10 @@ loadpath_fopen(const char *filename, const char *mode)
 {
     FILE *fp;
 
+    /* e.g. "load" of a script printed by a loop */
+    if (print_out)
+	fflush(print_out);
+
 #if defined(PIPES)
     if (*filename == '<') {
 	restrict_popen();
@@ -555,6 +555,7 @@ main(int argc, char **argv)
 #endif
 
 	load_file_error();	/* if we were in load_file(), cleanup */
+	term_state_reset();	/* an aborted plot may have left it active */
 	SET_CURSOR_ARROW;
 
 #ifdef VMS
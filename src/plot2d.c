@@ -683,12 +683,8 @@ get_data(struct curve_points *current_plot)
 
 	    if (current_plot->plot_style == TABLESTYLE) {
 	    /* Echo the values directly to the output file. FIXME: formats? */
-		int col;
 		int dummy_type = INRANGE;
-		FILE *outfile = (table_outfile) ? table_outfile : gpoutfile;
-		for (col = 0; col < j; col++)
-		    fprintf(outfile, " %g", v[col]);
-		fprintf(outfile, "\n");
+		tabulate_values(v, j);
 		/* This tracks x range and avoids "invalid x range" error message */
 		STORE_WITH_LOG_AND_UPDATE_RANGE( current_plot->points[i].x,
 			v[0], dummy_type, current_plot->x_axis,
@@ -1889,6 +1885,7 @@ eval_plots()
     int begin_token = c_token;  /* so we can rewind for second pass */
     int start_token=0, end_token;
     legend_key *key = &keyT;
+    struct sample_value *sampled;	/* function values from sample_function() */
 
     double newhist_start = 0.0;
     int histogram_sequence = -1;
@@ -2959,6 +2956,25 @@ eval_plots()
 			axis_unlog_interval(x_axis, &t_min, &t_max, 1);
 			t_step = (t_max - t_min) / (samples_1 - 1);
 		    }
+
+		    /* Evaluate all samples up front if this can be done in */
+		    /* several threads; otherwise one at a time below.      */
+		    sampled = NULL;
+		    if (sample_threads > 1) {
+			double *xs = gp_alloc(samples_1 * sizeof(double), "samples");
+			for (i = 0; i < samples_1; i++) {
+			    /* Same sample points as in the loop below */
+			    double t = t_min + i * t_step;
+			    if ((fabs(t) < 1.e-9) && (fabs(t_step) > 1.e-6))
+				t = 0.0;
+			    xs[i] = (!parametric && !polar)
+				? AXIS_DE_LOG_VALUE(x_axis, t) : t;
+			}
+			sampled = sample_function(&plot_func, samples_1, xs, NULL,
+						sample_threads);
+			free(xs);
+		    }
+
 		    for (i = 0; i < samples_1; i++) {
 			double x, temp;
 			struct value a;
@@ -2974,8 +2990,13 @@ eval_plots()
 			x = (!parametric && !polar)
 			    ? AXIS_DE_LOG_VALUE(x_axis, t) : t;
 
-			(void) Gcomplex(&plot_func.dummy_values[0], x, 0.0);
-			evaluate_at(plot_func.at, &a);
+			if (sampled) {
+			    a = sampled[i].val;
+			    undefined = sampled[i].undefined;
+			} else {
+			    (void) Gcomplex(&plot_func.dummy_values[0], x, 0.0);
+			    evaluate_at(plot_func.at, &a);
+			}
 
 			if (undefined || (fabs(imag(&a)) > zero)) {
 			    this_plot->points[i].type = UNDEFINED;
@@ -3106,6 +3127,7 @@ eval_plots()
 
 		    }   /* loop over samples_1 */
 		    this_plot->p_count = i;     /* samples_1 */
+		    free(sampled);
 		}
 		/* skip all modifers func / whole of data plots */
 		c_token = this_plot->token;
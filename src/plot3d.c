@@ -1225,6 +1225,29 @@ calculate_set_of_isolines(
     int i, j;
     struct coordinate GPHUGE *points = (*this_iso)->points;
     int do_update_color = need_palette && (!parametric || (parametric && value_axis == FIRST_Z_AXIS));
+    struct sample_value *sampled = NULL;
+
+    /* Evaluate the whole grid up front if this can be done in several */
+    /* threads; otherwise one point at a time below.                   */
+    if (sample_threads > 1) {
+	int n = num_iso_to_use * num_sam_to_use;
+	double *iso_val = gp_alloc(n * sizeof(double), "samples");
+	double *sam_val = gp_alloc(n * sizeof(double), "samples");
+
+	for (j = 0; j < num_iso_to_use; j++) {
+	    for (i = 0; i < num_sam_to_use; i++) {
+		iso_val[j * num_sam_to_use + i]
+		    = AXIS_DE_LOG_VALUE(iso_axis, iso_min + j * iso_step);
+		sam_val[j * num_sam_to_use + i]
+		    = AXIS_DE_LOG_VALUE(sam_axis, sam_min + i * sam_step);
+	    }
+	}
+	sampled = sample_function(&plot_func, n,
+			cross ? iso_val : sam_val, cross ? sam_val : iso_val,
+			sample_threads);
+	free(iso_val);
+	free(sam_val);
+    }
 
     for (j = 0; j < num_iso_to_use; j++) {
 	double iso = iso_min + j * iso_step;
@@ -1250,7 +1273,11 @@ calculate_set_of_isolines(
 		points[i].y = iso;
 	    }
 
-	    evaluate_at(plot_func.at, &a);
+	    if (sampled) {
+		a = sampled[j * num_sam_to_use + i].val;
+		undefined = sampled[j * num_sam_to_use + i].undefined;
+	    } else
+		evaluate_at(plot_func.at, &a);
 
 	    if (undefined || (fabs(imag(&a)) > zero)) {
 		points[i].type = UNDEFINED;
@@ -1270,6 +1297,7 @@ calculate_set_of_isolines(
 	*this_iso = (*this_iso)->next;
 	points = (*this_iso) ? (*this_iso)->points : NULL;
     }
+    free(sampled);
 }
 
 
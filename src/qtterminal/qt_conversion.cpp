@@ -117,23 +117,24 @@ QImage qt_imageToQImage(int M, int N, coordval* image, t_imagecolor color_mode)
 		}
 	// Palette color lookup from gray value
 	else
+	{
+		QVector<rgb255_color> rgb255_array(M*N);
+		const rgb255_color* rgb255_line = rgb255_array.constData();
+		rgb255maxcolors_from_gray_array(image, M*N, rgb255_array.data());
 		for (int n = 0; n < N; n++)
 		{
 			QRgb* line = (QRgb*)(qimage.scanLine(n));
 			for (int m = 0; m < M; m++)
 			{
 				if (isnan(*image))
-				{
-					image++;
 					*line++ = 0x00000000;
-				}
 				else
-				{
-					rgb255maxcolors_from_gray(*image++, &rgb255);
-					*line++ = qRgb(rgb255.r, rgb255.g, rgb255.b);
-				}
+					*line++ = qRgb(rgb255_line->r, rgb255_line->g, rgb255_line->b);
+				image++;
+				rgb255_line++;
 			}
 		}
+	}
 
 	return qimage;
 }
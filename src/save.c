@@ -618,11 +618,12 @@ set encoding %s\n\
 	fprintf(fp, "\nset view  %s", aspect_ratio_3D == 2 ? "equal xy" :
 			aspect_ratio_3D == 3 ? "equal xyz": "");
 
+    fprintf(fp, "\nset samples %d, %d", samples_1, samples_2);
+    if (sample_threads > 1)
+	fprintf(fp, " threads %d", sample_threads);
     fprintf(fp, "\n\
-set samples %d, %d\n\
 set isosamples %d, %d\n\
 %sset surface %s",
-	    samples_1, samples_2,
 	    iso_samples_1, iso_samples_2,
 	    (draw_surface) ? "" : "un",
 	    (implicit_surface) ? "" : "explicit");
@@ -676,6 +677,10 @@ set isosamples %d, %d\n\
 	fprintf(fp, "set datafile fortran\n");
     if (df_nofpe_trap)
 	fprintf(fp, "set datafile nofpe_trap\n");
+    if (df_cache_dir)
+	fprintf(fp, "set datafile cache '%s'\n", df_cache_dir);
+    if (df_prefetch_depth)
+	fprintf(fp, "set datafile prefetch %d\n", df_prefetch_depth);
 
     save_hidden3doptions(fp);
     fprintf(fp, "set cntrparam order %d\n", contour_order);
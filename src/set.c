@@ -46,6 +46,7 @@ static char *RCSid() { return RCSid("$Id: set.c,v 1.427 2013/12/29 17:34:06 mark
 #include "axis.h"
 #include "command.h"
 #include "contour.h"
+#include "datablock.h"
 #include "datafile.h"
 #include "fit.h"
 #include "gadgets.h"
@@ -58,6 +59,7 @@ static char *RCSid() { return RCSid("$Id: set.c,v 1.427 2013/12/29 17:34:06 mark
 #include "plot2d.h"
 #include "plot3d.h"
 #include "tables.h"
+#include "tabulate.h"
 #include "term_api.h"
 #include "util.h"
 #include "variable.h"
@@ -343,6 +345,29 @@ set_command()
 	    } else if (almost_equals(c_token,"nofpe_trap")) {
 		df_nofpe_trap = TRUE;
 		c_token++;
+	    } else if (equals(c_token,"cache")) {
+		char *dir;
+		c_token++;
+		if (!(dir = try_to_get_string()))
+		    int_error(c_token,"expecting directory name");
+		free(df_cache_dir);
+		df_cache_dir = dir;
+	    } else if (equals(c_token,"nocache")) {
+		free(df_cache_dir);
+		df_cache_dir = NULL;
+		c_token++;
+	    } else if (equals(c_token,"prefetch")) {
+		int depth = 2;
+		c_token++;
+		if (!END_OF_COMMAND) {
+		    depth = int_expression();
+		    if (depth < 2 || depth > 64)
+			int_error(c_token, "prefetch depth must be between 2 and 64");
+		}
+		df_prefetch_depth = depth;
+	    } else if (equals(c_token,"noprefetch")) {
+		df_prefetch_depth = 0;
+		c_token++;
 	    } else
 		int_error(c_token,"expecting datafile modifier");
 	    break;
@@ -4119,24 +4144,37 @@ set_samples()
     int tsamp1, tsamp2;
 
     c_token++;
-    tsamp1 = abs(int_expression());
-    tsamp2 = tsamp1;
-    if (!END_OF_COMMAND) {
-	if (!equals(c_token,","))
-	    int_error(c_token, "',' expected");
-	c_token++;
-	tsamp2 = abs(int_expression());
+    if (!almost_equals(c_token, "thr$eads")) {
+	tsamp1 = abs(int_expression());
+	tsamp2 = tsamp1;
+	if (!END_OF_COMMAND && !almost_equals(c_token, "thr$eads")) {
+	    if (!equals(c_token,","))
+		int_error(c_token, "',' expected");
+	    c_token++;
+	    tsamp2 = abs(int_expression());
+	}
+	if (tsamp1 < 2 || tsamp2 < 2)
+	    int_error(c_token, "sampling rate must be > 1; sampling unchanged");
+	else {
+	    struct surface_points *f_3dp = first_3dplot;
+
+	    first_3dplot = NULL;
+	    sp_free(f_3dp);
+
+	    samples_1 = tsamp1;
+	    samples_2 = tsamp2;
+	}
     }
-    if (tsamp1 < 2 || tsamp2 < 2)
-	int_error(c_token, "sampling rate must be > 1; sampling unchanged");
-    else {
-	struct surface_points *f_3dp = first_3dplot;
 
-	first_3dplot = NULL;
-	sp_free(f_3dp);
+    /* Functions may be sampled in several threads */
+    if (almost_equals(c_token, "thr$eads")) {
+	int threads;
 
-	samples_1 = tsamp1;
-	samples_2 = tsamp2;
+	c_token++;
+	threads = int_expression();
+	if (threads < 1)
+	    int_error(c_token, "number of threads must be > 0");
+	sample_threads = threads;
     }
 }
 
@@ -4375,13 +4413,26 @@ set_table()
 	fclose(table_outfile);
 	table_outfile = NULL;
     }
-
-    if ((tablefile = try_to_get_string())) {
+    table_var = NULL;
+    table_binary = FALSE;
+
+    if (equals(c_token, "$") && isletter(c_token+1)) {
+    /* 'set table $foo {binary}' writes to a datablock */
+	table_var = add_udv_by_name(parse_datablock_name());
+	if (equals(c_token, "binary")) {
+	    table_binary = TRUE;
+	    c_token++;
+	} else if (!(table_outfile = tmpfile()))
+	    os_error(c_token, "cannot open temporary file for table output");
+	init_table_datablock();
+    } else if ((tablefile = try_to_get_string())) {
     /* 'set table "foo"' creates a new output file */
 	if (!(table_outfile = fopen(tablefile, "w")))
 	   os_error(c_token, "cannot open table output file");
 	free(tablefile);
     }
+    if (table_outfile)
+	setvbuf(table_outfile, NULL, _IOFBF, TABLE_BUFSIZE);
 
     table_mode = TRUE;
 
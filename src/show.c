@@ -46,6 +46,7 @@ static char *RCSid() { return RCSid("$Id: show.c,v 1.311 2013/12/26 17:58:29 sfe
 #include "axis.h"
 #include "command.h"
 #include "contour.h"
+#include "datablock.h"
 #include "datafile.h"
 #include "eval.h"
 #include "fit.h"
@@ -2631,6 +2632,8 @@ show_samples()
 {
     SHOW_ALL_NL;
     fprintf(stderr, "\tsampling rate is %d, %d\n", samples_1, samples_2);
+    if (sample_threads > 1)
+	fprintf(stderr, "\tfunctions are sampled in %d threads\n", sample_threads);
 }
 
 
@@ -3019,6 +3022,18 @@ show_datafile()
 	fputs("\tDatafile parsing will accept Fortran D or Q constants\n",stderr);
     if (df_nofpe_trap)
 	fputs("\tNo floating point exception handler during data input\n",stderr);
+    if (END_OF_COMMAND || equals(c_token,"cache")) {
+	if (df_cache_dir)
+	    fprintf(stderr, "\tParsed data files are cached in \"%s\"\n", df_cache_dir);
+	else
+	    fputs("\tParsed data files are not cached\n", stderr);
+    }
+    if (END_OF_COMMAND || equals(c_token,"prefetch")) {
+	if (df_prefetch_depth)
+	    fprintf(stderr, "\tData files are read ahead into %d buffers\n", df_prefetch_depth);
+	else
+	    fputs("\tData files are not read ahead\n", stderr);
+    }
 
     if (almost_equals(c_token,"bin$ary")) {
 	if (!END_OF_COMMAND)
@@ -3401,11 +3416,7 @@ disp_value(FILE *fp, struct value *val, TBOOLEAN need_quotes)
 	break;
     case DATABLOCK:
 	{
-	char **dataline = val->v.data_array;
-	int nlines = 0;
-	if (dataline)
-	    while (*dataline++)
-		nlines++;
+	int nlines = val->v.data_array ? val->v.data_array->nlines : 0;
 	fprintf(fp, "<%d line data block>", nlines);
 	break;
 	}
@@ -3428,7 +3439,8 @@ num_to_str(double r)
     if (i > 3)
 	i = 0;
 
-    sprintf(s[j], "%.15g", r);
+    if (format_g(s[j], sizeof(s[j]), "", 0, 15, FALSE, r) < 0)
+	sprintf(s[j], "%.15g", r);
     if (strchr(s[j], '.') == NULL &&
 	strchr(s[j], 'e') == NULL &&
 	strchr(s[j], 'E') == NULL)
@@ -629,16 +629,22 @@ void f_igamma(union argument *arg)
 
 void f_gamma(union argument *arg)
 {
-    double y;
+    double x, y;
+    int sign;
     struct value a;
 
     (void) arg;				/* avoid -Wunused warning */
-    y = GAMMA(real(pop(&a)));
+    x = real(pop(&a));
+    y = GAMMA(x);
+    /* The sign of gamma(x) alternates between the poles at x <= 0.  Work */
+    /* it out here rather than read the global signgam, which is not safe */
+    /* when functions are sampled in several threads.                     */
+    sign = (x > 0 || fmod(ceil(-x), 2.0) == 0) ? 1 : -1;
     if (y > E_MAXEXP) {
 	undefined = TRUE;
 	push(Ginteger(&a, 0));
     } else
-	push(Gcomplex(&a, signgam * gp_exp(y), 0.0));
+	push(Gcomplex(&a, sign * gp_exp(y), 0.0));
 }
 
 void f_lgamma(union argument *arg)
@@ -244,6 +244,12 @@ extern char *sys_errlist[];
 
 #endif /* HAVE_SYS_STAT_H */
 
+/* Memory-mapped input of binary data files */
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H)
+# include <sys/mman.h>
+# define USE_MMAP 1
+#endif
+
 #ifdef HAVE_LIMITS_H
 # include <limits.h>
 #else
@@ -355,6 +355,18 @@ typedef RETSIGTYPE (*sigfunc)__PROTO((void));
 # endif
 #endif
 
+/* Thread-local storage for the state of the expression evaluator, so that
+ * functions can be sampled in several threads ('set samples ... threads').
+ * Without pthreads or a compiler that knows __thread this is a no-op and
+ * all sampling is done serially.
+ */
+#if defined(HAVE_LIBPTHREAD) && defined(__GNUC__)
+# define GP_THREAD_LOCAL __thread
+# define PARALLEL_SAMPLING
+#else
+# define GP_THREAD_LOCAL /*nothing*/
+#endif
+
 #if HAVE_STDBOOL_H
 # include <stdbool.h>
 #else
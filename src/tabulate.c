@@ -45,7 +45,9 @@ static char *RCSid() { return RCSid("$Id: tabulate.c,v 1.18 2014/01/10 03:31:09
 
 #include "alloc.h"
 #include "axis.h"
+#include "datablock.h"
 #include "datafile.h"
+#include "eval.h"
 #include "gp_time.h"
 #include "graphics.h"
 #include "graph3d.h"
@@ -54,15 +56,34 @@ static char *RCSid() { return RCSid("$Id: tabulate.c,v 1.18 2014/01/10 03:31:09
 #include "tabulate.h"
 
 static char *expand_newline __PROTO((const char *in));
+static struct datablock *table_datablock __PROTO((void));
+static void table_newline __PROTO((void));
+static void table_comment __PROTO((void));
+static void table_value __PROTO((double value));
+static void table_text_to_datablock __PROTO((void));
 
 static FILE *outfile;
 
+/* "set table $name binary" stores the numbers of the table unformatted
+ * in a binary datablock.  Comments and text fields are left out, but the
+ * rows and blank lines are those of the text table, so that index and
+ * every select the same points from either.
+ */
+static struct datablock *table_numbers = NULL;
+static enum {
+    TABLE_LINE_EMPTY, TABLE_LINE_DATA, TABLE_LINE_COMMENT
+} table_line = TABLE_LINE_EMPTY;
+
 /* This routine got longer than is reasonable for a macro */
 #define OUTPUT_NUMBER(x,y) output_number(x,y,buffer)
 #define BUFFERSIZE 150
 
 static void
 output_number(double coord, int axis, char *buffer) {
+    if (table_numbers) {
+	table_value(coord);
+	return;
+    }
     /* treat timedata and "%s" output format as a special case:
      * return a number.
      * "%s" in combination with any other character is treated
@@ -93,6 +114,8 @@ print_table(struct curve_points *current_plot, int plot_num)
     int i, curve;
     char *buffer = gp_alloc(BUFFERSIZE, "print_table: output buffer");
     outfile = (table_outfile) ? table_outfile : gpoutfile;
+    table_numbers = (table_var && table_binary) ? table_datablock() : NULL;
+    table_line = TABLE_LINE_EMPTY;
 
     for (curve = 0; curve < plot_num;
 	 curve++, current_plot = current_plot->next) {
@@ -102,75 +125,84 @@ print_table(struct curve_points *current_plot, int plot_num)
 	if (current_plot->plot_style == TABLESTYLE)
 	    continue;
 
-	/* two blank lines between tabulated plots by prepending \n here */
-	fprintf(outfile, "\n# Curve %d of %d, %d points",
-		curve, plot_num, current_plot->p_count);
+	if (table_numbers) {
+	    /* The same lines as the header below */
+	    table_comment();
+	    if ((current_plot->title) && (*current_plot->title))
+		table_comment();
+	    table_comment();
+	    table_newline();
+	} else {
+	    /* two blank lines between tabulated plots by prepending \n here */
+	    fprintf(outfile, "\n# Curve %d of %d, %d points",
+		    curve, plot_num, current_plot->p_count);
+
+	    if ((current_plot->title) && (*current_plot->title)) {
+		char *title = expand_newline(current_plot->title);
+		fprintf(outfile, "\n# Curve title: \"%s\"", title);
+		free(title);
+	    }
 
-	if ((current_plot->title) && (*current_plot->title)) {
-	    char *title = expand_newline(current_plot->title);
-    	    fprintf(outfile, "\n# Curve title: \"%s\"", title);
-	    free(title);
-	}
+	    fprintf(outfile, "\n# x y");
+	    switch (current_plot->plot_style) {
+	    case BOXES:
+	    case XERRORBARS:
+		fputs(" xlow xhigh", outfile);
+		break;
+	    case BOXERROR:
+	    case YERRORBARS:
+		fputs(" ylow yhigh", outfile);
+		break;
+	    case BOXXYERROR:
+	    case XYERRORBARS:
+		fputs(" xlow xhigh ylow yhigh", outfile);
+		break;
+	    case FILLEDCURVES:
+		fputs("1 y2", outfile);
+		break;
+	    case FINANCEBARS:
+		fputs(" open ylow yhigh yclose", outfile);
+		break;
+	    case CANDLESTICKS:
+		fputs(" open ylow yhigh yclose width", outfile);
+		break;
+	    case LABELPOINTS:
+		fputs(" label",outfile);
+		break;
+	    case VECTOR:
+		fputs(" delta_x delta_y",outfile);
+		break;
+	    case LINES:
+	    case POINTSTYLE:
+	    case LINESPOINTS:
+	    case DOTS:
+	    case IMPULSES:
+	    case STEPS:
+	    case FSTEPS:
+	    case HISTEPS:
+		break;
+	    case IMAGE:
+		fputs("  pixel", outfile);
+		break;
+	    case RGBIMAGE:
+	    case RGBA_IMAGE:
+		fputs("  red green blue alpha", outfile);
+		break;
+
+	    default:
+		if (interactive)
+		    fprintf(stderr, "Tabular output of %s plot style not fully implemented\n",
+			current_plot->plot_style == HISTOGRAMS ? "histograms" :
+			"this");
+		break;
+	    }
 
-	fprintf(outfile, "\n# x y");
-	switch (current_plot->plot_style) {
-	case BOXES:
-	case XERRORBARS:
-	    fputs(" xlow xhigh", outfile);
-	    break;
-	case BOXERROR:
-	case YERRORBARS:
-	    fputs(" ylow yhigh", outfile);
-	    break;
-	case BOXXYERROR:
-	case XYERRORBARS:
-	    fputs(" xlow xhigh ylow yhigh", outfile);
-	    break;
-	case FILLEDCURVES:
-	    fputs("1 y2", outfile);
-	    break;
-	case FINANCEBARS:
-	    fputs(" open ylow yhigh yclose", outfile);
-	    break;
-	case CANDLESTICKS:
-	    fputs(" open ylow yhigh yclose width", outfile);
-	    break;
-	case LABELPOINTS:
-	    fputs(" label",outfile);
-	    break;
-	case VECTOR:
-	    fputs(" delta_x delta_y",outfile);
-	    break;
-	case LINES:
-	case POINTSTYLE:
-	case LINESPOINTS:
-	case DOTS:
-	case IMPULSES:
-	case STEPS:
-	case FSTEPS:
-	case HISTEPS:
-	    break;
-	case IMAGE:
-	    fputs("  pixel", outfile);
-	    break;
-	case RGBIMAGE:
-	case RGBA_IMAGE:
-	    fputs("  red green blue alpha", outfile);
-	    break;
+	    if (current_plot->varcolor)
+		fputs("  color", outfile);
 
-	default:
-	    if (interactive)
-		fprintf(stderr, "Tabular output of %s plot style not fully implemented\n",
-		    current_plot->plot_style == HISTOGRAMS ? "histograms" :
-		    "this");
-	    break;
+	    fputs(" type\n", outfile);
 	}
 
-	if (current_plot->varcolor)
-	    fputs("  color", outfile);
-
-	fputs(" type\n", outfile);
-
 	if (current_plot->plot_style == LABELPOINTS) {
 	    struct text_label *this_label;
 	    for (this_label = current_plot->labels->next; this_label != NULL;
@@ -178,7 +210,10 @@ print_table(struct curve_points *current_plot, int plot_num)
 		 char *label = expand_newline(this_label->text);
 		 OUTPUT_NUMBER(this_label->place.x, current_plot->x_axis);
 		 OUTPUT_NUMBER(this_label->place.y, current_plot->y_axis);
-		fprintf(outfile, " \"%s\"\n", label);
+		if (table_numbers)
+		    table_newline();
+		else
+		    fprintf(outfile, " \"%s\"\n", label);
 		free(label);
 	    }
 
@@ -192,7 +227,10 @@ print_table(struct curve_points *current_plot, int plot_num)
 
 		/* Reproduce blank lines read from original input file, if any */
 		if (!memcmp(point, &blank_data_line, sizeof(struct coordinate))) {
-		    fprintf(outfile, "\n");
+		    if (table_numbers)
+			table_newline();
+		    else
+			fprintf(outfile, "\n");
 		    continue;
 		}
 
@@ -219,10 +257,20 @@ print_table(struct curve_points *current_plot, int plot_num)
 			OUTPUT_NUMBER(point->yhigh, current_plot->y_axis);
 			break;
 		    case IMAGE:
-			fprintf(outfile,"%g ",point->z);
+			if (table_numbers)
+			    table_value(point->z);
+			else
+			    fprintf(outfile,"%g ",point->z);
 			break;
 		    case RGBIMAGE:
 		    case RGBA_IMAGE:
+			if (table_numbers) {
+			    table_value((int)point->CRD_R);
+			    table_value((int)point->CRD_G);
+			    table_value((int)point->CRD_B);
+			    table_value((int)point->CRD_A);
+			    break;
+			}
 			fprintf(outfile,"%4d ",(int)point->CRD_R);
 			fprintf(outfile,"%4d ",(int)point->CRD_G);
 			fprintf(outfile,"%4d ",(int)point->CRD_B);
@@ -264,7 +312,10 @@ print_table(struct curve_points *current_plot, int plot_num)
 		    double colorval = current_plot->varcolor[i];
 		    if ((current_plot->lp_properties.pm3d_color.value < 0.0)
 		    &&  (current_plot->lp_properties.pm3d_color.type == TC_RGB)) {
-			fprintf(outfile, "0x%06x", (unsigned int)(colorval));
+			if (table_numbers)
+			    table_value((unsigned int)(colorval));
+			else
+			    fprintf(outfile, "0x%06x", (unsigned int)(colorval));
 		    } else if (current_plot->lp_properties.pm3d_color.type == TC_Z) {
 			OUTPUT_NUMBER(colorval, COLOR_AXIS);
 		    } else if (current_plot->lp_properties.l_type == LT_COLORFROMCOLUMN) {
@@ -272,17 +323,28 @@ print_table(struct curve_points *current_plot, int plot_num)
 		    }
 		}
 
-		fprintf(outfile, " %c\n",
-		    current_plot->points[i].type == INRANGE
-		    ? 'i' : current_plot->points[i].type == OUTRANGE
-		    ? 'o' : 'u');
+		if (table_numbers)
+		    table_newline();
+		else {
+		    putc(' ', outfile);
+		    putc(current_plot->points[i].type == INRANGE
+			? 'i' : current_plot->points[i].type == OUTRANGE
+			? 'o' : 'u', outfile);
+		    putc('\n', outfile);
+		}
 	    } /* for(point i) */
 	}
 
-	putc('\n', outfile);
+	if (table_numbers)
+	    table_newline();
+	else
+	    putc('\n', outfile);
     } /* for(curve) */
 
     fflush(outfile);
+    if (table_var && !table_binary)
+	table_text_to_datablock();
+    table_numbers = NULL;
     free(buffer);
 }
 
@@ -296,15 +358,24 @@ print_3dtable(int pcount)
     struct coordinate GPHUGE *tail;
     char *buffer = gp_alloc(BUFFERSIZE, "print_3dtable output buffer");
     outfile = (table_outfile) ? table_outfile : gpoutfile;
+    table_numbers = (table_var && table_binary) ? table_datablock() : NULL;
+    table_line = TABLE_LINE_EMPTY;
 
     for (surface = 0, this_plot = first_3dplot;
 	 surface < pcount;
 	 this_plot = this_plot->next_sp, surface++) {
-	fprintf(outfile, "\n# Surface %d of %d surfaces\n", surface, pcount);
+	if (table_numbers) {
+	    table_comment();
+	    table_newline();
+	} else
+	    fprintf(outfile, "\n# Surface %d of %d surfaces\n", surface, pcount);
 
 	if ((this_plot->title) && (*this_plot->title)) {
 	    char *title = expand_newline(this_plot->title);
-    	    fprintf(outfile, "\n# Curve title: \"%s\"", title);
+	    if (table_numbers)
+		table_comment();
+	    else
+		fprintf(outfile, "\n# Curve title: \"%s\"", title);
 	    free(title);
 	}
 
@@ -318,7 +389,10 @@ print_3dtable(int pcount)
 		 OUTPUT_NUMBER(this_label->place.x, FIRST_X_AXIS);
 		 OUTPUT_NUMBER(this_label->place.y, FIRST_Y_AXIS);
 		 OUTPUT_NUMBER(this_label->place.z, FIRST_Z_AXIS);
-		fprintf(outfile, " \"%s\"\n", label);
+		if (table_numbers)
+		    table_newline();
+		else
+		    fprintf(outfile, " \"%s\"\n", label);
 		free(label);
 	    }
 	    }
@@ -344,14 +418,21 @@ print_3dtable(int pcount)
 		 icrvs && curve < this_plot->num_iso_read;
 		 icrvs = icrvs->next, curve++) {
 
-		fprintf(outfile, "\n# IsoCurve %d, %d points\n# x y z",
-			curve, icrvs->p_count);
-		if (this_plot->plot_style == VECTOR) {
+		if (this_plot->plot_style == VECTOR)
 		    tail = icrvs->next->points;
-		    fprintf(outfile, " delta_x delta_y delta_z");
-		} else tail = NULL;  /* Just to shut up a compiler warning */
-
-		fprintf(outfile, " type\n");
+		else
+		    tail = NULL;  /* Just to shut up a compiler warning */
+		if (table_numbers) {
+		    table_comment();
+		    table_comment();
+		    table_newline();
+		} else {
+		    fprintf(outfile, "\n# IsoCurve %d, %d points\n# x y z",
+			    curve, icrvs->p_count);
+		    if (this_plot->plot_style == VECTOR)
+			fprintf(outfile, " delta_x delta_y delta_z");
+		    fprintf(outfile, " type\n");
+		}
 
 		for (i = 0, point = icrvs->points;
 		     i < icrvs->p_count;
@@ -365,15 +446,24 @@ print_3dtable(int pcount)
 			OUTPUT_NUMBER((tail->z - point->z), FIRST_Z_AXIS);
 			tail++;
 		    } else if (this_plot->plot_style == IMAGE) {
-			fprintf(outfile,"%g ",point->CRD_COLOR);
+			if (table_numbers)
+			    table_value(point->CRD_COLOR);
+			else
+			    fprintf(outfile,"%g ",point->CRD_COLOR);
 		    }
-		    fprintf(outfile, "%c\n",
-			    point->type == INRANGE
-			    ? 'i' : point->type == OUTRANGE
-			    ? 'o' : 'u');
+		    if (table_numbers)
+			table_newline();
+		    else
+			fprintf(outfile, "%c\n",
+				point->type == INRANGE
+				? 'i' : point->type == OUTRANGE
+				? 'o' : 'u');
 		} /* for(point) */
 	    } /* for(icrvs) */
-	    putc('\n', outfile);
+	    if (table_numbers)
+		table_newline();
+	    else
+		putc('\n', outfile);
 	} /* if(draw_surface) */
 
 	if (draw_contour) {
@@ -384,32 +474,156 @@ print_3dtable(int pcount)
 		int count = c->num_pts;
 		struct coordinate GPHUGE *point = c->coords;
 
-		if (c->isNewLevel)
+		if (c->isNewLevel) {
 		    /* don't display count - contour split across chunks */
 		    /* put # in case user wants to use it for a plot */
 		    /* double blank line to allow plot ... index ... */
-		    fprintf(outfile, "\n# Contour %d, label: %s\n",
-			    number++, c->label);
+		    if (table_numbers) {
+			table_comment();
+			table_newline();
+			number++;
+		    } else
+			fprintf(outfile, "\n# Contour %d, label: %s\n",
+				number++, c->label);
+		}
 
 		for (; --count >= 0; ++point) {
 		    OUTPUT_NUMBER(point->x, FIRST_X_AXIS);
 		    OUTPUT_NUMBER(point->y, FIRST_Y_AXIS);
 		    OUTPUT_NUMBER(point->z, FIRST_Z_AXIS);
-		    putc('\n', outfile);
+		    if (table_numbers)
+			table_newline();
+		    else
+			putc('\n', outfile);
 		}
 
 		/* blank line between segments of same contour */
-		putc('\n', outfile);
+		if (table_numbers)
+		    table_newline();
+		else
+		    putc('\n', outfile);
 		c = c->next;
 
 	    } /* while (contour) */
 	} /* if (draw_contour) */
     } /* for(surface) */
     fflush(outfile);
+    if (table_var && !table_binary)
+	table_text_to_datablock();
+    table_numbers = NULL;
 
     free(buffer);
 }
 
+/* "plot ... with table" echoes the input values of each point */
+void
+tabulate_values(double *v, int n)
+{
+    int col;
+
+    if (table_var && table_binary) {
+	struct datablock *datablock = table_datablock();
+	for (col = 0; col < n; col++)
+	    datablock_add_value(datablock, v[col]);
+	datablock_end_row(datablock);
+    } else {
+	char buffer[32];
+	outfile = (table_outfile) ? table_outfile : gpoutfile;
+	for (col = 0; col < n; col++) {
+	    if (format_g(buffer, sizeof(buffer), "", 0, -1, FALSE, v[col]) < 0)
+		snprintf(buffer, sizeof(buffer), "%g", v[col]);
+	    putc(' ', outfile);
+	    fputs(buffer, outfile);
+	}
+	putc('\n', outfile);
+    }
+}
+
+/* Make the variable named by "set table $name" an empty datablock */
+void
+init_table_datablock()
+{
+    if (!table_var->udv_undef) {
+	gpfree_string(&table_var->udv_value);
+	gpfree_datablock(&table_var->udv_value);
+    }
+    table_var->udv_undef = FALSE;
+    table_var->udv_value.type = DATABLOCK;
+    table_var->udv_value.v.data_array = new_datablock();
+    table_var->udv_value.v.data_array->binary = table_binary;
+}
+
+/* The datablock being written by "set table $name".  Start a new one
+ * if the variable has been given another value in the meantime.
+ */
+static struct datablock *
+table_datablock()
+{
+    if (table_var->udv_undef || table_var->udv_value.type != DATABLOCK
+    ||  table_var->udv_value.v.data_array == NULL
+    ||  table_var->udv_value.v.data_array->binary != table_binary)
+	init_table_datablock();
+    return table_var->udv_value.v.data_array;
+}
+
+/* Binary table: end the current line.  A line that held no numbers
+ * becomes an empty row, a comment line nothing.
+ */
+static void
+table_newline()
+{
+    if (table_line != TABLE_LINE_COMMENT)
+	datablock_end_row(table_numbers);
+    table_line = TABLE_LINE_EMPTY;
+}
+
+/* Binary table: "\n# ..." */
+static void
+table_comment()
+{
+    table_newline();
+    table_line = TABLE_LINE_COMMENT;
+}
+
+static void
+table_value(double value)
+{
+    if (table_line == TABLE_LINE_EMPTY)
+	table_line = TABLE_LINE_DATA;
+    if (table_line == TABLE_LINE_DATA)
+	datablock_add_value(table_numbers, value);
+}
+
+/* Text table: move what has been written to the temporary file since
+ * the last time into the datablock, one line at a time.
+ */
+static void
+table_text_to_datablock()
+{
+    struct datablock *datablock = table_datablock();
+    size_t size = MAX_LINE_LEN;
+    char *dataline = gp_alloc(size, "table");
+
+    rewind(table_outfile);
+    while (fgets(dataline, size, table_outfile)) {
+	size_t len = strlen(dataline);
+	while (len > 0 && dataline[len-1] != '\n') {
+	    dataline = gp_realloc(dataline, size *= 2, "table");
+	    if (!fgets(dataline + len, size - len, table_outfile))
+		break;
+	    len += strlen(dataline + len);
+	}
+	append_to_datablock(datablock, dataline);
+    }
+    free(dataline);
+
+    /* start again with an empty file */
+    fclose(table_outfile);
+    if (!(table_outfile = tmpfile()))
+	int_error(NO_CARET, "cannot open temporary file for table output");
+    setvbuf(table_outfile, NULL, _IOFBF, TABLE_BUFSIZE);
+}
+
 static char *
 expand_newline(const char *in)
 {
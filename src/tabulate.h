@@ -9,10 +9,15 @@
 
 #include "syscfg.h"
 
+/* stdio buffer size for the files written by "set table" and "set print" */
+#define TABLE_BUFSIZE 65536
+
 /* Routines in tabulate.c needed by other modules: */
 
 void print_table __PROTO((struct curve_points * first_plot, int plot_num));
 void print_3dtable __PROTO((int pcount));
+void tabulate_values __PROTO((double *v, int n));
+void init_table_datablock __PROTO((void));
 
 
 #endif /* GNUPLOT_TABULATE_H */
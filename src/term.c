@@ -195,6 +195,11 @@ TBOOLEAN ignore_enhanced_text = FALSE;
 /* Recycle count for user-defined linetypes */
 int linetype_recycle_count = 0;
 
+/* Number of redundant set_color/linetype/linewidth/set_font calls that
+ * the terminal state cache did not pass on to the driver.
+ */
+unsigned long term_state_elided = 0;
+
 
 /* Internal variables */
 
@@ -213,6 +218,37 @@ static TBOOLEAN term_force_init = FALSE;
 /* internal pointsize for do_point */
 static double term_pointsize=1;
 
+/* Cache of the drawing state last passed to the driver.  While a plot is
+ * being drawn, term_state_install() routes the terminal's set_color,
+ * linetype, linewidth and set_font entries through the state_* wrappers
+ * below, which drop calls that would not change anything.  Entries that
+ * may alter the driver state behind our back (text, images, layers,
+ * palettes) only invalidate the cache.  Drivers whose other entries
+ * reset their pen state in ways the cache cannot see set the flag
+ * TERM_NO_STATE_CACHE and are not wrapped at all.
+ */
+static struct {
+    struct termentry *owner;	/* terminal whose entries are wrapped */
+    void (*linetype) __PROTO((int));
+    void (*linewidth) __PROTO((double));
+    void (*set_color) __PROTO((t_colorspec *));
+    int (*set_font) __PROTO((const char *));
+    void (*put_text) __PROTO((unsigned int, unsigned int, const char *));
+    void (*image) __PROTO((unsigned int, unsigned int, coordval *, gpiPoint *, t_imagecolor));
+    void (*layer) __PROTO((t_termlayer));
+    int (*make_palette) __PROTO((t_sm_palette *));
+
+    TBOOLEAN have_linetype;
+    int cur_linetype;
+    TBOOLEAN have_linewidth;
+    double cur_linewidth;
+    TBOOLEAN have_color;
+    t_colorspec cur_color;
+    TBOOLEAN have_font;
+    char *cur_font;
+    int font_status;
+} term_state;
+
 /* Internal prototypes: */
 
 static void term_suspend __PROTO((void));
@@ -237,6 +273,17 @@ static void PUTTEXT_null __PROTO((unsigned int, unsigned int, const char *));
 
 static int strlen_tex __PROTO((const char *));
 
+static void term_state_install __PROTO((void));
+static void term_state_invalidate __PROTO((void));
+static void state_linetype __PROTO((int));
+static void state_linewidth __PROTO((double));
+static void state_set_color __PROTO((t_colorspec *));
+static int state_set_font __PROTO((const char *));
+static void state_put_text __PROTO((unsigned int, unsigned int, const char *));
+static void state_image __PROTO((unsigned int, unsigned int, coordval *, gpiPoint *, t_imagecolor));
+static void state_layer __PROTO((t_termlayer));
+static int state_make_palette __PROTO((t_sm_palette *));
+
 /* Used by terminals and by shared routine parse_term_size() */
 typedef enum {
     PIXELS,
@@ -564,6 +611,10 @@ term_start_plot()
 	term_suspended = FALSE;
     }
 
+    /* Drop redundant color, linetype and font changes while drawing */
+    term_state_install();
+    term_state_invalidate();
+
     /* Sync point for epslatex text positioning */
     (*term->layer)(TERM_LAYER_RESET);
 
@@ -651,6 +702,7 @@ term_end_plot()
 
     /* Sync point for epslatex text positioning */
     (*term->layer)(TERM_LAYER_END_TEXT);
+    term_state_reset();
 
     if (!multiplot) {
 	FPRINTF((stderr, "- calling term->text()\n"));
@@ -930,6 +982,8 @@ term_reset()
     paused_for_mouse = 0;
 #endif
 
+    term_state_reset();
+
     if (!term_initialised)
 	return;
 
@@ -1579,6 +1633,166 @@ null_set_color(struct t_colorspec *colorspec)
 	term->linetype(colorspec->lt);
 }
 
+/*
+ * Terminal state cache.  Only the entries of the terminal selected at the
+ * time term_start_plot() is called are wrapped; term_state_reset() puts
+ * the driver's own entries back.  An entry that a driver has replaced in
+ * the meantime (e.g. put_text by its options routine) is left alone.
+ */
+static void
+term_state_install()
+{
+    if (term_state.owner == term)
+	return;
+    term_state_reset();
+    if (term->flags & TERM_NO_STATE_CACHE)
+	return;
+    term_state.owner = term;
+
+#define WRAP_ENTRY(entry) \
+    if (term->entry) { \
+	term_state.entry = term->entry; \
+	term->entry = state_ ## entry; \
+    }
+    WRAP_ENTRY(linetype);
+    WRAP_ENTRY(linewidth);
+    WRAP_ENTRY(set_color);
+    WRAP_ENTRY(set_font);
+    WRAP_ENTRY(put_text);
+    WRAP_ENTRY(image);
+    WRAP_ENTRY(layer);
+    WRAP_ENTRY(make_palette);
+#undef WRAP_ENTRY
+}
+
+void
+term_state_reset()
+{
+    struct termentry *t = term_state.owner;
+
+    term_state_invalidate();
+    if (!t)
+	return;
+
+#define UNWRAP_ENTRY(entry) \
+    if (t->entry == state_ ## entry) \
+	t->entry = term_state.entry; \
+    term_state.entry = NULL;
+    UNWRAP_ENTRY(linetype);
+    UNWRAP_ENTRY(linewidth);
+    UNWRAP_ENTRY(set_color);
+    UNWRAP_ENTRY(set_font);
+    UNWRAP_ENTRY(put_text);
+    UNWRAP_ENTRY(image);
+    UNWRAP_ENTRY(layer);
+    UNWRAP_ENTRY(make_palette);
+#undef UNWRAP_ENTRY
+
+    term_state.owner = NULL;
+}
+
+static void
+term_state_invalidate()
+{
+    term_state.have_linetype = FALSE;
+    term_state.have_linewidth = FALSE;
+    term_state.have_color = FALSE;
+    term_state.have_font = FALSE;
+    free(term_state.cur_font);
+    term_state.cur_font = NULL;
+}
+
+/* A new linetype also selects a new color, and vice versa */
+static void
+state_linetype(int linetype)
+{
+    if (term_state.have_linetype && term_state.cur_linetype == linetype) {
+	term_state_elided++;
+	return;
+    }
+    (*term_state.linetype)(linetype);
+    term_state.have_color = FALSE;
+    term_state.have_linetype = TRUE;
+    term_state.cur_linetype = linetype;
+}
+
+static void
+state_linewidth(double linewidth)
+{
+    if (term_state.have_linewidth && term_state.cur_linewidth == linewidth) {
+	term_state_elided++;
+	return;
+    }
+    (*term_state.linewidth)(linewidth);
+    term_state.have_linewidth = TRUE;
+    term_state.cur_linewidth = linewidth;
+    /* Some drivers (e.g. PostScript) apply a new width only at the next
+     * linetype call, so that one must not be dropped.
+     */
+    term_state.have_linetype = FALSE;
+}
+
+static void
+state_set_color(t_colorspec *colorspec)
+{
+    if (term_state.have_color
+    &&  term_state.cur_color.type == colorspec->type
+    &&  term_state.cur_color.lt == colorspec->lt
+    &&  term_state.cur_color.value == colorspec->value) {
+	term_state_elided++;
+	return;
+    }
+    (*term_state.set_color)(colorspec);
+    term_state.have_linetype = FALSE;
+    term_state.have_color = TRUE;
+    term_state.cur_color = *colorspec;
+}
+
+static int
+state_set_font(const char *font)
+{
+    if (term_state.have_font
+    &&  (font == term_state.cur_font
+	 || (font && term_state.cur_font && !strcmp(font, term_state.cur_font)))) {
+	term_state_elided++;
+	return term_state.font_status;
+    }
+    term_state.font_status = (*term_state.set_font)(font);
+    free(term_state.cur_font);
+    term_state.cur_font = font ? gp_strdup(font) : NULL;
+    term_state.have_font = TRUE;
+    return term_state.font_status;
+}
+
+static void
+state_put_text(unsigned int x, unsigned int y, const char *str)
+{
+    (*term_state.put_text)(x, y, str);
+    term_state_invalidate();
+}
+
+static void
+state_image(unsigned int M, unsigned int N, coordval *image, gpiPoint *corner, t_imagecolor color_mode)
+{
+    (*term_state.image)(M, N, image, corner, color_mode);
+    term_state_invalidate();
+}
+
+static void
+state_layer(t_termlayer layer)
+{
+    (*term_state.layer)(layer);
+    term_state_invalidate();
+}
+
+static int
+state_make_palette(t_sm_palette *palette)
+{
+    int ret = (*term_state.make_palette)(palette);
+    term_state_invalidate();
+    return ret;
+}
+
 /* setup the magic macros to compile in the right parts of the
  * terminal drivers included by term.h
  */
@@ -1742,6 +1956,7 @@ change_term(const char *origname, int length)
 	return (NULL);
 
     /* Success: set terminal type now */
+    term_state_reset();
 
     term = t;
     term_initialised = FALSE;
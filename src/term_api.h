@@ -217,6 +217,7 @@ typedef struct t_image {
 #define TERM_IS_LATEX        (1<<13)	/* text uses TeX markup            */
 #define TERM_EXTENDED_COLOR  (1<<14)	/* uses EXTENDED_COLOR_SPECS       */
 #define TERM_NULL_SET_COLOR  (1<<15)	/* no support for RGB color        */
+#define TERM_NO_STATE_CACHE  (1<<16)	/* don't elide repeated pen changes */
 
 /* The terminal interface structure --- heart of the terminal layer.
  *
@@ -370,6 +371,9 @@ extern TBOOLEAN curr_arrow_headfixedsize;
 /* Recycle count for user-defined linetypes */
 extern int linetype_recycle_count;
 
+/* Number of redundant terminal state changes dropped by term.c */
+extern unsigned long term_state_elided;
+
 /* Current 'output' file: name and open filehandle */
 extern char *outstr;
 extern FILE *gpoutfile;
@@ -422,6 +426,7 @@ void term_end_multiplot __PROTO((void));
 /* void term_suspend __PROTO((void)); */
 void term_reset __PROTO((void));
 void term_apply_lp_properties __PROTO((struct lp_style_type *lp));
+void term_state_reset __PROTO((void));
 void term_check_multiplot_okay __PROTO((TBOOLEAN));
 struct termentry *change_term __PROTO((const char *name, int length));
 
@@ -49,6 +49,7 @@ static char *RCSid() { return RCSid("$Id: time.c,v 1.27 2013/07/03 14:05:40 sfea
 
 #include "gp_time.h"
 
+#include "alloc.h"
 #include "util.h"
 #include "variable.h"
 
@@ -75,6 +76,8 @@ read_int(char *s, int nr, int *d)
  */
 
 static int gdysize __PROTO((int yr));
+static long days_from_civil __PROTO((long y, int m, long d));
+static void civil_from_days __PROTO((long days, long *y, int *m, int *d));
 
 static int mndday[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
@@ -94,6 +97,166 @@ gdysize(int yr)
 }
 
 
+/* Days from 1 Jan 1970 to the given date of the proleptic Gregorian
+ * calendar (month 1..12).  Closed form, so that converting a date does
+ * not have to loop over all the years since ZERO_YEAR.  The day of month
+ * is not range checked; mday = 0 or mday = 32 just count on from the
+ * first of the month.
+ */
+static long
+days_from_civil(long y, int m, long d)
+{
+    long era, yoe, doy, doe;
+
+    y -= (m <= 2);
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;				/* [0, 399] */
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;	/* [0, 365] */
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;	/* [0, 146096] */
+    return era * 146097 + doe - 719468;
+}
+
+/* Inverse of days_from_civil() */
+static void
+civil_from_days(long days, long *y, int *m, int *d)
+{
+    long era, doe, yoe, doy, mp;
+
+    days += 719468;
+    era = (days >= 0 ? days : days - 146096) / 146097;
+    doe = days - era * 146097;				/* [0, 146096] */
+    yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;	/* [0, 399] */
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);	/* [0, 365] */
+    mp = (5 * doy + 2) / 153;				/* [0, 11], March = 0 */
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+
+/* gstrptime() interprets the same format for every line of a data file.
+ * The format is translated once into a list of fields, which is kept
+ * until a different format string comes along.  Formats consisting only
+ * of fixed-width numeric fields and literal separators, like the ISO 8601
+ * "%Y-%m-%dT%H:%M:%S", are marked 'fixed': an input string that has all
+ * the digits in place is checked and converted in a single pass.
+ * Anything else falls back to the general field-by-field interpretation.
+ */
+typedef struct time_field {
+    char type;		/* conversion letter, or ' ' / 'L' for space / literal */
+    char literal;	/* the character to match for type 'L' */
+    int width;		/* maximum number of digits of numeric fields */
+} time_field;
+
+#define MAX_TIME_FIELDS 10
+
+static struct {
+    char *format;	/* copy of the format string compiled below */
+    time_field *field;
+    int n_fields;
+    TBOOLEAN fixed;	/* only fixed-width numeric fields and literals */
+    TBOOLEAN epoch;	/* the format is just "%s" */
+    int date, yday;	/* number of date and day-of-year fields */
+} timefmt_compiled = { NULL, NULL, 0, FALSE, FALSE, 0, 0 };
+
+static void compile_timefmt __PROTO((char *fmt));
+static void store_time_field __PROTO((int type, int value, struct tm *tm));
+
+static void
+compile_timefmt(char *fmt)
+{
+    int n = 0;
+    TBOOLEAN fixed = TRUE;
+    size_t len = strlen(fmt);
+    char *f;
+
+    free(timefmt_compiled.format);
+    free(timefmt_compiled.field);
+    timefmt_compiled.format = gp_strdup(fmt);
+    timefmt_compiled.field = gp_alloc((len + 1) * sizeof(time_field), "timefmt");
+    timefmt_compiled.date = timefmt_compiled.yday = 0;
+
+    for (f = fmt; *f; f++) {
+	time_field *field = &timefmt_compiled.field[n++];
+
+	field->width = 0;
+	field->literal = '\0';
+	if (*f != '%') {
+	    field->type = (*f == ' ') ? ' ' : 'L';
+	    field->literal = *f;
+	    if (*f == ' ')
+		fixed = FALSE;
+	    continue;
+	}
+	field->type = *++f;
+	switch (field->type) {
+	case 'd': case 'm': case 'y':
+	case 'H': case 'M': case 'S':
+		field->width = 2; break;
+	case 'j':
+		field->width = 3; timefmt_compiled.yday++; break;
+	case 'Y':
+		field->width = 4; break;
+	case '\0':
+		/* '%' at the end of the format */
+		field->type = '?';
+		f--;
+		/* fall through */
+	default:
+		fixed = FALSE;
+	}
+	if (strchr("dmyYj", field->type))
+	    timefmt_compiled.date++;
+    }
+    timefmt_compiled.n_fields = n;
+    timefmt_compiled.epoch = (n == 1 && timefmt_compiled.field[0].type == 's');
+
+    /* %S may be followed by a fraction of unknown length, so it
+     * can only be the last field of a fixed-width format */
+    if (fixed && n > 0) {
+	int i;
+	for (i = 0; i < n - 1; i++)
+	    if (timefmt_compiled.field[i].type == 'S')
+		fixed = FALSE;
+    }
+    if (fixed && n > 0) {
+	int i;
+	int numeric = 0;
+	for (i = 0; i < n; i++)
+	    if (timefmt_compiled.field[i].type != 'L')
+		numeric++;
+	if (numeric > MAX_TIME_FIELDS)
+	    fixed = FALSE;
+    }
+    timefmt_compiled.fixed = fixed && n > 0;
+}
+
+/* Store the value read for a numeric field */
+static void
+store_time_field(int type, int value, struct tm *tm)
+{
+    switch (type) {
+    case 'd':	tm->tm_mday = value; break;
+    case 'm':	tm->tm_mon = value - 1; break;
+    case 'y':
+	/* In line with the current UNIX98 specification by
+	 * The Open Group and major Unix vendors,
+	 * two-digit years 69-99 refer to the 20th century, and
+	 * values in the range 00-68 refer to the 21st century.
+	 */
+	if (value <= 68)
+	    value += 100;
+	tm->tm_year = value + 1900;
+	break;
+    case 'Y':	tm->tm_year = value; break;
+    case 'j':	tm->tm_yday = value - 1; break;
+    case 'H':	tm->tm_hour = value; break;
+    case 'M':	tm->tm_min = value; break;
+    case 'S':	tm->tm_sec = value; break;
+    }
+}
+
+
 /* new strptime() and gmtime() to allow time to be read as 24 hour,
  * and spaces in the format string. time is converted to seconds from
  * year 2000.... */
@@ -102,6 +265,10 @@ char *
 gstrptime(char *s, char *fmt, struct tm *tm, double *usec)
 {
     int yday, date;
+    int i;
+
+    if (!timefmt_compiled.format || strcmp(fmt, timefmt_compiled.format))
+	compile_timefmt(fmt);
 
     date = yday = 0;
     tm->tm_mday = 1;
@@ -120,24 +287,63 @@ gstrptime(char *s, char *fmt, struct tm *tm, double *usec)
 
     tm->tm_yday = tm->tm_wday = -1;
 
-    while (*fmt) {
-	if (*fmt != '%') {
-	    if (*fmt == ' ') {
-		/* space in format means zero or more spaces in input */
-		while (*s == ' ')
-		    ++s;
-		++fmt;
-		continue;
-	    } else if (*fmt == *s) {
-		++s;
-		++fmt;
+    /* Fixed-width format: if every numeric field of the input has exactly
+     * 'width' digits and the separators match, one pass converts it */
+    if (timefmt_compiled.fixed) {
+	char *c = s;
+	int value[MAX_TIME_FIELDS];
+	int n = 0;
+
+	for (i = 0; i < timefmt_compiled.n_fields; i++) {
+	    time_field *field = &timefmt_compiled.field[i];
+	    int w;
+
+	    if (field->type == 'L') {
+		if (*c++ != field->literal)
+		    break;
 		continue;
-	    } else
-		break;		/* literal match has failed */
+	    }
+	    value[n] = 0;
+	    for (w = field->width; w > 0 && *c >= '0' && *c <= '9'; w--)
+		value[n] = value[n] * 10 + (*c++ - '0');
+	    if (w > 0)
+		break;
+	    n++;
+	}
+	if (i == timefmt_compiled.n_fields) {
+	    n = 0;
+	    for (i = 0; i < timefmt_compiled.n_fields; i++) {
+		time_field *field = &timefmt_compiled.field[i];
+		if (field->type != 'L')
+		    store_time_field(field->type, value[n++], tm);
+	    }
+	    s = c;
+	    if (timefmt_compiled.field[timefmt_compiled.n_fields-1].type == 'S'
+	    &&  (*s == '.' || (decimalsign && *s == *decimalsign)))
+		*usec = atof(s);
+	    date = timefmt_compiled.date;
+	    yday = timefmt_compiled.yday;
+	    goto normalize;
 	}
-	/* we are processing a percent escape */
+    }
+
+    for (i = 0; i < timefmt_compiled.n_fields; i++) {
+	time_field *field = &timefmt_compiled.field[i];
+	int value;
+
+	switch (field->type) {
+	case ' ':
+	    /* space in format means zero or more spaces in input */
+	    while (*s == ' ')
+		++s;
+	    continue;
+
+	case 'L':
+	    if (*s != field->literal)
+		goto normalize;		/* literal match has failed */
+	    ++s;
+	    continue;
 
-	switch (*++fmt) {
 	case 'b':		/* abbreviated month name */
 	    {
 		int m;
@@ -174,52 +380,26 @@ gstrptime(char *s, char *fmt, struct tm *tm, double *usec)
 		break;
 	    }
 
-	case 'd':		/* read a day of month */
-	    s = read_int(s, 2, &tm->tm_mday);
-	    date++;
-	    break;
-
+	case 'd':		/* day of month */
 	case 'm':		/* month number */
-	    s = read_int(s, 2, &tm->tm_mon);
-	    date++;
-	    --tm->tm_mon;
-	    break;
-
 	case 'y':		/* year number */
-	    s = read_int(s, 2, &tm->tm_year);
-	    /* In line with the current UNIX98 specification by
-	     * The Open Group and major Unix vendors,
-	     * two-digit years 69-99 refer to the 20th century, and
-	     * values in the range 00-68 refer to the 21st century.
-	     */
-	    if (tm->tm_year <= 68)
-		tm->tm_year += 100;
-	    date++;
-	    tm->tm_year += 1900;
-	    break;
-
 	case 'Y':
-	    s = read_int(s, 4, &tm->tm_year);
-	    date++;
-	    break;
-
 	case 'j':
-	    s = read_int(s, 3, &tm->tm_yday);
-	    tm->tm_yday--;
+	    s = read_int(s, field->width, &value);
+	    store_time_field(field->type, value, tm);
 	    date++;
-	    yday++;
+	    if (field->type == 'j')
+		yday++;
 	    break;
 
 	case 'H':
-	    s = read_int(s, 2, &tm->tm_hour);
-	    break;
-
 	case 'M':
-	    s = read_int(s, 2, &tm->tm_min);
+	    s = read_int(s, field->width, &value);
+	    store_time_field(field->type, value, tm);
 	    break;
 
 	case 'S':
-	    s = read_int(s, 2, &tm->tm_sec);
+	    s = read_int(s, field->width, &tm->tm_sec);
 	    if (*s == '.' || (decimalsign && *s == *decimalsign))
 		*usec = atof(s);
 	    break;
@@ -238,15 +418,18 @@ gstrptime(char *s, char *fmt, struct tm *tm, double *usec)
 		    ufraction = atof(fraction);
 		if (ufraction < 1.)		/* Filter out e.g. 123.456e7 */
 		    *usec = ufraction;
+		/* Nothing left to normalize for a plain epoch format */
+		if (timefmt_compiled.epoch)
+		    return (s);
 		break;
 	    }
 
 	default:
 	    int_warn(DATAFILE, "Bad time format in string");
 	}
-	fmt++;
     }
 
+  normalize:
     FPRINTF((stderr, "read date-time : %02d/%02d/%d:%02d:%02d:%02d\n", tm->tm_mday, tm->tm_mon + 1, tm->tm_year, tm->tm_hour, tm->tm_min, tm->tm_sec));
 
     /* now check the date/time entered, normalising if necessary
@@ -605,27 +788,15 @@ xstrftime(
 double
 gtimegm(struct tm *tm)
 {
-    int i;
     /* returns sec from year ZERO_YEAR, defined in gp_time.h */
-    double dsec = 0.;
-
-    if (tm->tm_year < ZERO_YEAR) {
-	for (i = tm->tm_year; i < ZERO_YEAR; i++) {
-	    dsec -= (double) gdysize(i);
-	}
-    } else {
-	for (i = ZERO_YEAR; i < tm->tm_year; i++) {
-	    dsec += (double) gdysize(i);
-	}
-    }
-    if (tm->tm_mday > 0) {
-	for (i = 0; i < tm->tm_mon; i++) {
-	    dsec += (double) mndday[i] + (i == 1 && (gdysize(tm->tm_year) > 365));
-	}
-	dsec += (double) tm->tm_mday - 1;
-    } else {
-	dsec += (double) tm->tm_yday;
-    }
+    double dsec;
+
+    if (tm->tm_mday > 0)
+	dsec = (double) (days_from_civil(tm->tm_year, tm->tm_mon + 1, tm->tm_mday)
+			- days_from_civil(ZERO_YEAR, 1, 1));
+    else
+	dsec = (double) (days_from_civil(tm->tm_year, 1, 1)
+			- days_from_civil(ZERO_YEAR, 1, 1) + tm->tm_yday);
     dsec *= (double) 24;
 
     dsec += tm->tm_hour;
@@ -644,10 +815,10 @@ int
 ggmtime(struct tm *tm, double l_clock)
 {
     /* l_clock is relative to ZERO_YEAR, jan 1, 00:00:00,defined in plot.h */
-    int i, days;
-
-    /* dodgy way of doing wday - i hope it works ! */
-    int wday = JAN_FIRST_WDAY;	/* eg 6 for 2000 */
+    double days;
+    long year;
+    int month, mday;
+    long zero_day = days_from_civil(ZERO_YEAR, 1, 1);
 
     FPRINTF((stderr, "%g seconds = ", l_clock));
     if (fabs(l_clock) > 1.e12) {  /* Some time in the year 33688 */
@@ -655,44 +826,33 @@ ggmtime(struct tm *tm, double l_clock)
 	return(-1);
     }
 
-    tm->tm_year = ZERO_YEAR;
-    tm->tm_mday = tm->tm_yday = tm->tm_mon = tm->tm_hour = tm->tm_min = tm->tm_sec = 0;
+    /* split into whole days and seconds into the day */
+    days = floor(l_clock / DAY_SEC);
+    l_clock -= days * DAY_SEC;
     if (l_clock < 0) {
-	while (l_clock < 0) {
-	    int days_in_year = gdysize(--tm->tm_year);
-	    l_clock += days_in_year * DAY_SEC;	/* 24*3600 */
-	    /* adding 371 is noop in modulo 7 arithmetic, but keeps wday +ve */
-	    wday += 371 - days_in_year;
-	}
-    } else {
-	for (;;) {
-	    int days_in_year = gdysize(tm->tm_year);
-	    if (l_clock < days_in_year * DAY_SEC)
-		break;
-	    l_clock -= days_in_year * DAY_SEC;
-	    tm->tm_year++;
-	    /* only interested in result modulo 7, but %7 is expensive */
-	    wday += (days_in_year - 364);
-	}
+	days -= 1;
+	l_clock += DAY_SEC;
+    } else if (l_clock >= DAY_SEC) {
+	days += 1;
+	l_clock -= DAY_SEC;
     }
-    tm->tm_yday = (int) (l_clock / DAY_SEC);
-    l_clock -= tm->tm_yday * DAY_SEC;
+
+    civil_from_days((long) days + zero_day, &year, &month, &mday);
+    tm->tm_year = year;
+    tm->tm_mon = month - 1;
+    tm->tm_mday = mday;
+    tm->tm_yday = (long) days + zero_day - days_from_civil(year, 1, 1);
+
     tm->tm_hour = (int) l_clock / 3600;
     l_clock -= tm->tm_hour * 3600;
     tm->tm_min = (int) l_clock / 60;
     l_clock -= tm->tm_min * 60;
     tm->tm_sec = (int) l_clock;
 
-    days = tm->tm_yday;
-
-    /* wday%7 should be day of week of first day of year */
-    tm->tm_wday = (wday + days) % 7;
-
-    while (days >= (i = mndday[tm->tm_mon] + (tm->tm_mon == 1 && (gdysize(tm->tm_year) > 365)))) {
-	days -= i;
-	tm->tm_mon++;
-    }
-    tm->tm_mday = days + 1;
+    /* JAN_FIRST_WDAY is the day of the week of 1 jan ZERO_YEAR */
+    tm->tm_wday = (int) (((long) days + JAN_FIRST_WDAY) % 7);
+    if (tm->tm_wday < 0)
+	tm->tm_wday += 7;
 
     FPRINTF((stderr, "broken-down time : %02d/%02d/%d:%02d:%02d:%02d\n", tm->tm_mday, tm->tm_mon + 1, tm->tm_year, tm->tm_hour, tm->tm_min, tm->tm_sec));
 
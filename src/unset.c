@@ -297,6 +297,15 @@ unset_command()
 	    df_nofpe_trap = FALSE;
 	    c_token++;
 	    break;
+	} else if (equals(c_token,"cache")) {
+	    free(df_cache_dir);
+	    df_cache_dir = NULL;
+	    c_token++;
+	    break;
+	} else if (equals(c_token,"prefetch")) {
+	    df_prefetch_depth = 0;
+	    c_token++;
+	    break;
 	}
 	df_fortran_constants = FALSE;
 	unset_missing();
@@ -304,6 +313,9 @@ unset_command()
 	df_separators = NULL;
 	free(df_commentschars);
 	df_commentschars = gp_strdup(DEFAULT_COMMENTS_CHARS);
+	free(df_cache_dir);
+	df_cache_dir = NULL;
+	df_prefetch_depth = 0;
 	df_unset_datafile_binary();
 	break;
 #ifdef USE_MOUSE
@@ -1352,6 +1364,7 @@ unset_samples()
 
     samples_1 = SAMPLES;
     samples_2 = SAMPLES;
+    sample_threads = 1;
 }
 
 
@@ -1464,6 +1477,8 @@ unset_table()
     if (table_outfile)
 	fclose(table_outfile);
     table_outfile = NULL;
+    table_var = NULL;
+    table_binary = FALSE;
     table_mode = FALSE;
 }
 
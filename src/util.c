@@ -522,6 +522,226 @@ mant_exp(
 /*}}} */
 
 
+/*{{{  format_g */
+/* Format x the way snprintf(dest, size, "%<flags><width>.<precision>g", x)
+ * would in the C locale, but without going through printf.  Writing
+ * tables and printing values formats millions of numbers this way.
+ * The number is scaled by an exact power of ten and rounded to the
+ * requested digits; where that rounding cannot be decided from the
+ * double product (an almost exact tie), or for zero with a sign, NaN,
+ * infinity, extreme exponents or unusual flags, -1 is returned and the
+ * caller should use snprintf instead.  Otherwise the return value is
+ * the length of the string written to dest.
+ */
+int
+format_g(
+    char *dest,
+    size_t size,
+    const char *flags,
+    int width,
+    int precision,
+    TBOOLEAN upper,
+    double x)
+{
+    static const double pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    TBOOLEAN left = FALSE, plus = FALSE, space = FALSE;
+    char digits[16];
+    char buf[32];
+    char *s = buf;
+    int exp10 = 0;
+    int ndigits, len, i;
+
+    for (; *flags; flags++) {
+	if (*flags == '-')
+	    left = TRUE;
+	else if (*flags == '+')
+	    plus = TRUE;
+	else if (*flags == ' ')
+	    space = TRUE;
+	else
+	    return -1;
+    }
+    if (precision < 0)
+	precision = 6;
+    else if (precision == 0)
+	precision = 1;
+    if (precision > 15 || width > 64 || !(fabs(x) <= DBL_MAX))
+	return -1;
+
+    if (x == 0) {
+	if (1.0 / x < 0)	/* -0 */
+	    return -1;
+	digits[0] = '0';
+	ndigits = 1;
+    } else {
+	double ax = fabs(x);
+	double m, n;
+	unsigned long long u;
+	int k, tries;
+
+	/* Find m = ax * 10^k with precision digits before the point */
+	exp10 = (int) floor(log10(ax));
+	for (tries = 0; ; tries++) {
+	    k = precision - 1 - exp10;
+	    if (k > 22 || k < -22 || tries > 2)
+		return -1;
+	    m = (k >= 0) ? ax * pow10[k] : ax / pow10[-k];
+	    if (m < pow10[precision-1])
+		exp10--;
+	    else if (m >= pow10[precision])
+		exp10++;
+	    else
+		break;
+	}
+
+	/* The product is off by at most half an ulp of m */
+	n = floor(m);
+	if (fabs(m - n - 0.5) <= m * DBL_EPSILON)
+	    return -1;
+	if (m - n > 0.5)
+	    n += 1;
+	if (n >= pow10[precision]) {
+	    n = pow10[precision-1];
+	    exp10++;
+	}
+	u = (unsigned long long) n;
+	for (i = precision - 1; i >= 0; i--) {
+	    digits[i] = '0' + (int)(u % 10);
+	    u /= 10;
+	}
+	ndigits = precision;
+	while (ndigits > 1 && digits[ndigits-1] == '0')
+	    ndigits--;
+    }
+
+    if (x < 0)
+	*s++ = '-';
+    else if (plus)
+	*s++ = '+';
+    else if (space)
+	*s++ = ' ';
+
+    if (exp10 < -4 || exp10 >= precision) {
+	int e = (exp10 < 0) ? -exp10 : exp10;
+	*s++ = digits[0];
+	if (ndigits > 1) {
+	    *s++ = '.';
+	    memcpy(s, digits + 1, ndigits - 1);
+	    s += ndigits - 1;
+	}
+	*s++ = upper ? 'E' : 'e';
+	*s++ = (exp10 < 0) ? '-' : '+';
+	if (e >= 100)
+	    *s++ = '0' + e / 100;
+	*s++ = '0' + (e / 10) % 10;
+	*s++ = '0' + e % 10;
+    } else if (exp10 >= 0) {
+	for (i = 0; i <= exp10; i++)
+	    *s++ = (i < ndigits) ? digits[i] : '0';
+	if (ndigits > exp10 + 1) {
+	    *s++ = '.';
+	    memcpy(s, digits + exp10 + 1, ndigits - exp10 - 1);
+	    s += ndigits - exp10 - 1;
+	}
+    } else {
+	*s++ = '0';
+	*s++ = '.';
+	for (i = -1; i > exp10; i--)
+	    *s++ = '0';
+	memcpy(s, digits, ndigits);
+	s += ndigits;
+    }
+
+    len = s - buf;
+    if (width < len)
+	width = len;
+    if ((size_t) width >= size)
+	return -1;
+    memset(dest, ' ', width);
+    memcpy(left ? dest : dest + width - len, buf, len);
+    dest[width] = '\0';
+    return width;
+}
+
+/*}}} */
+
+/*{{{  gprintf_compile */
+/* gprintf() is called with the same format again and again when writing
+ * a table, so the last format is kept in parsed form.  It is "simple"
+ * if it holds a single e, f, g or h conversion with no # or ' flag,
+ * surrounded by plain text.
+ */
+static struct {
+    char format[64];
+    TBOOLEAN simple;
+    int prefix;			/* length of the text before '%' */
+    const char *suffix;		/* text after the conversion, in format[] */
+    char spec[64];		/* the conversion for snprintf, h -> g */
+    char flags[8];
+    int width;
+    int precision;		/* -1 if not given */
+    char conversion;
+} gprintf_format;
+
+static TBOOLEAN
+gprintf_compile(const char *format)
+{
+    const char *f, *p;
+    char *t;
+    int nflags = 0;
+
+    if (!strcmp(format, gprintf_format.format))
+	return gprintf_format.simple;
+    if (strlen(format) >= sizeof(gprintf_format.format))
+	return FALSE;
+    strcpy(gprintf_format.format, format);
+    gprintf_format.simple = FALSE;
+
+    if (!(p = strchr(format, '%')))
+	return FALSE;
+    f = p + 1;
+    t = gprintf_format.spec;
+    *t++ = '%';
+    while (*f == '-' || *f == '+' || *f == ' ' || *f == '0') {
+	if (nflags >= (int)sizeof(gprintf_format.flags) - 1)
+	    return FALSE;
+	gprintf_format.flags[nflags++] = *f;
+	*t++ = *f++;
+    }
+    gprintf_format.flags[nflags] = '\0';
+    gprintf_format.width = 0;
+    while (isdigit((unsigned char) *f)) {
+	gprintf_format.width = 10 * gprintf_format.width + (*f - '0');
+	*t++ = *f++;
+    }
+    gprintf_format.precision = -1;
+    if (*f == '.') {
+	*t++ = *f++;
+	gprintf_format.precision = 0;
+	while (isdigit((unsigned char) *f)) {
+	    gprintf_format.precision = 10 * gprintf_format.precision + (*f - '0');
+	    *t++ = *f++;
+	}
+    }
+    if (!*f || !strchr("eEfFgGhH", *f) || strchr(f + 1, '%'))
+	return FALSE;
+    gprintf_format.conversion = *f;
+    *t++ = (*f == 'h') ? 'g' : (*f == 'H') ? 'G' : *f;
+    *t = '\0';
+    if (gprintf_format.width > 64 || gprintf_format.precision > 64)
+	return FALSE;
+
+    gprintf_format.prefix = p - format;
+    gprintf_format.suffix = gprintf_format.format + (f + 1 - format);
+    gprintf_format.simple = TRUE;
+    return TRUE;
+}
+
+/*}}} */
+
 /*{{{  gprintf */
 /* extended s(n)printf */
 /* HBB 20010121: added code to maintain consistency between mantissa
@@ -563,6 +783,40 @@ gprintf(
     if (((term->flags & TERM_IS_LATEX)) && !strcmp(format, DEF_FORMAT))
 	format = DEF_FORMAT_LATEX;
 
+    /* The usual case: one number, no decimalsign, and a format that has
+     * been seen before.  Anything not written completely here is done
+     * again the long way below.
+     */
+    if (decimalsign == NULL
+    &&  (numeric_locale == NULL || !strcmp(numeric_locale, "C"))
+    &&  gprintf_compile(format)) {
+	char conversion = gprintf_format.conversion;
+	size_t prefix = gprintf_format.prefix;
+	int len = -1;
+
+	/* %h in enhanced text needs the markup added below */
+	if ((conversion == 'h' || conversion == 'H') && !table_mode
+	&&  (term->flags & (TERM_ENHANCED_TEXT | TERM_IS_LATEX)))
+	    ;
+	else if (prefix < count) {
+	    memcpy(outstring, format, prefix);
+	    if (strchr("gGhH", conversion))
+		len = format_g(outstring + prefix, count - prefix,
+			gprintf_format.flags, gprintf_format.width,
+			gprintf_format.precision,
+			(conversion == 'G' || conversion == 'H'), x);
+	    if (len < 0)
+		len = snprintf(outstring + prefix, count - prefix,
+			gprintf_format.spec, x);
+	    if (len >= 0
+	    &&  prefix + len + strlen(gprintf_format.suffix) < count) {
+		strcpy(outstring + prefix + len, gprintf_format.suffix);
+		reset_numeric_locale();
+		return;
+	    }
+	}
+    }
+
     for (;;) {
 	/*{{{  copy to dest until % */
 	while (*format != '%')
@@ -1069,6 +1323,9 @@ int_error(int t_num, const char str[], va_dcl)
 
     char error_message[128] = {'\0'};
 
+    /* Inside a sampling thread this does not return */
+    sample_worker_error();
+
     /* reprint line if screen has been written to */
 
     if (t_num == DATAFILE) {
@@ -1129,6 +1386,9 @@ int_warn(int t_num, const char str[], va_dcl)
     va_list args;
 #endif
 
+    /* Inside a sampling thread this does not return */
+    sample_worker_error();
+
     /* reprint line if screen has been written to */
 
     if (t_num == DATAFILE) {
@@ -90,6 +90,7 @@ char *gp_strdup __PROTO((const char *));
 
 /* HBB 20020405: moved this here, from axis.[ch] */
 void gprintf __PROTO((char *, size_t, char *, double, double));
+int format_g __PROTO((char *, size_t, const char *, int, int, TBOOLEAN, double));
 
 /* Error message handling */
 #if defined(VA_START) && defined(STDC_HEADERS)
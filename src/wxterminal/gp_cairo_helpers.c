@@ -93,17 +93,24 @@ unsigned int * gp_cairo_helper_coordval_to_chars(coordval* image, int M, int N,
 		}
 	/* Palette plot->color lookup from gray value */
 	} else {
+		rgb255_color *rgb255_array = (rgb255_color*) malloc(M*N*sizeof(rgb255_color));
+		rgb255_color *rgb255copy = rgb255_array;
+		if (!rgb255_array) { fprintf(stderr,"cairo terminal: out of memory!\n"); gp_exit(EXIT_FAILURE);}
+		rgb255maxcolors_from_gray_array( image, M*N, rgb255_array );
 		for (n=0; n<N; n++) {
 		for (m=0; m<M; m++) {
 			if (isnan(*image)) {
 				image++;
+				rgb255copy++;
 				*image255copy++ = 0x00000000;
 			} else {
-				rgb255maxcolors_from_gray( *image++, &rgb255 );
+				image++;
+				rgb255 = *rgb255copy++;
 				*image255copy++ = (0xFF<<24) + (rgb255.r<<16) + (rgb255.g<<8) + rgb255.b;
 			}
 		}
 		}
+		free(rgb255_array);
 	}
 
 	return image255;
@@ -651,6 +651,9 @@ wxtPanel::wxtPanel( wxWindow *parent, wxWindowID id, const wxSize& size )
 
 	settings_queued = false;
 
+	command_list = new wxtCommandBuffer;
+	pending_list = new wxtCommandBuffer;
+
 #ifdef USE_MOUSE
 	mouse_x = 0;
 	mouse_y = 0;
@@ -697,8 +700,11 @@ wxtPanel::~wxtPanel()
 	FPRINTF((stderr,"panel destructor\n"));
 	wxt_cairo_free_context();
 
-	/* clear the command list, free the allocated memory */
-	ClearCommandlist();
+	/* free the command lists */
+	command_list_mutex.Lock();
+	ReleaseCommandlist(command_list);
+	ReleaseCommandlist(pending_list);
+	command_list_mutex.Unlock();
 }
 
 /* temporary store new settings values to be applied for the next plot */
@@ -727,29 +733,112 @@ void wxtPanel::wxt_settings_apply()
 	mutex_queued.Unlock();
 }
 
-/* clear the command list, free the allocated memory */
+/* empty the pending command list before a new plot.
+ * The gui thread only ever replays command_list, so the pending list is
+ * private to gnuplot and is recycled, keeping its capacity. */
 void wxtPanel::ClearCommandlist()
 {
 	command_list_mutex.Lock();
+	ReleaseCommandlist(pending_list->prefix);
+	command_list_mutex.Unlock();
+	pending_list->prefix = NULL;
+	pending_list->clear();
+}
 
-	command_list_t::iterator iter; /*declare the iterator*/
+/* make the commands of the completed plot the ones replayed on refresh.
+ * The gui thread may now replay the published list at any time, so gnuplot
+ * must not write into it any more : the caller has to switch to the new
+ * pending_list. This is the previously displayed list, recycled, or a fresh
+ * one if it is still held by the gui or by a multiplot.
+ * This is also called when suspending the terminal between the plots of a
+ * multiplot. The next plot is then drawn over what has been drawn so far :
+ * the new pending list is empty and has the published one as its prefix,
+ * which is shared rather than copied. */
+void wxtPanel::PublishCommandlist()
+{
+	command_list_mutex.Lock();
 
-	/* run through the list, and free allocated memory */
-	for(iter = command_list.begin(); iter != command_list.end(); ++iter) {
-		if ( iter->command == command_put_text ||
-			iter->command == command_hypertext ||
-			iter->command == command_set_font)
-			delete[] iter->string;
-		if (iter->command == command_filled_polygon)
-			delete[] iter->corners;
-		if (iter->command == command_image)
-			free(iter->image);
+	wxtCommandBuffer *previous = command_list;
+	command_list = pending_list;
+
+	if (!multiplot && previous->refs == 1) {
+		ReleaseCommandlist(previous->prefix);
+		previous->prefix = NULL;
+		previous->clear();
+		pending_list = previous;
+	} else {
+		ReleaseCommandlist(previous);
+		pending_list = new wxtCommandBuffer;
+		if (multiplot) {
+			pending_list->prefix = command_list;
+			command_list->refs++;
+		}
 	}
 
-	command_list.clear();
 	command_list_mutex.Unlock();
 }
 
+/* drop a reference to a list, and delete it and the prefixes nobody holds
+ * any more. The caller must hold command_list_mutex. */
+void wxtPanel::ReleaseCommandlist(wxtCommandBuffer *buffer)
+{
+	while (buffer && --buffer->refs == 0) {
+		wxtCommandBuffer *prefix = buffer->prefix;
+		delete buffer;
+		buffer = prefix;
+	}
+}
+
+/* append a vertex to the current polyline, or start a new one */
+void wxtCommandBuffer::push_vertex(unsigned int x, unsigned int y)
+{
+	gpiPoint vertex;
+
+	vertex.x = x;
+	vertex.y = y;
+	vertex.style = 0;
+
+	if (commands.empty() || commands.back().command != command_polyline) {
+		gp_command temp_command;
+		temp_command.command = command_polyline;
+		temp_command.integer_value = 0;
+		temp_command.offset = points.size();
+		commands.push_back(temp_command);
+	}
+
+	points.push_back(vertex);
+	commands.back().integer_value++;
+}
+
+/* copy a string to the arena, and have the command refer to it */
+void wxtCommandBuffer::push_string(gp_command &command, const char *string)
+{
+	command.offset = strings.size();
+	/* Note : we must take '\0' (EndOfLine) into account */
+	strings.insert(strings.end(), string, string + strlen(string) + 1);
+}
+
+/* copy n points to the arena, and have the command refer to them */
+void wxtCommandBuffer::push_points(gp_command &command, const gpiPoint *corners, int n)
+{
+	command.offset = points.size();
+	points.insert(points.end(), corners, corners + n);
+}
+
+/* forget all commands, free the images but keep the arenas allocated */
+void wxtCommandBuffer::clear()
+{
+	std::vector<gp_command>::iterator iter; /*declare the iterator*/
+
+	for(iter = commands.begin(); iter != commands.end(); ++iter)
+		if (iter->command == command_image)
+			free(iter->image);
+
+	commands.clear();
+	strings.clear();
+	points.clear();
+}
+
 
 /* method called when the panel has to be painted
  * -> Refresh(), window dragged, dialogs over the window, etc. */
@@ -1734,7 +1823,6 @@ void wxt_init()
 	/* initialize helper pointers */
 	wxt_current_panel = wxt_current_window->frame->panel;
 	wxt_current_plot = &(wxt_current_panel->plot);
-	wxt_current_command_list = &(wxt_current_panel->command_list);
 
 	wxt_sigint_check();
 
@@ -1875,8 +1963,9 @@ void wxt_graphics()
 	term->v_tic = (unsigned int) (term->v_char/2.5);
 	term->h_tic = (unsigned int) (term->v_char/2.5);
 
-	/* clear the command list, and free the allocated memory */
+	/* clear the pending command list */
 	wxt_current_panel->ClearCommandlist();
+	wxt_current_command_list = wxt_current_panel->pending_list;
 
 	/* Don't reset the hide_plot flags if this refresh is a zoom/unzoom */
 	if (wxt_zoom_command)
@@ -1918,6 +2007,11 @@ void wxt_text()
 
 	FPRINTF((stderr,"Text0 %d\n", sw.Time())); /*performance watch*/
 
+	/* the plot is complete, have it replayed from now on.
+	 * Further commands (next plot of a multiplot) go to the new pending list */
+	wxt_current_panel->PublishCommandlist();
+	wxt_current_command_list = wxt_current_panel->pending_list;
+
 	/* translates the command list to a bitmap */
 	wxt_MutexGuiEnter();
 	wxt_current_panel->wxt_cairo_refresh();
@@ -1983,13 +2077,10 @@ void wxt_vector(unsigned int x, unsigned int y)
 	if (wxt_status != STATUS_OK)
 		return;
 
-	gp_command temp_command;
-
-	temp_command.command = command_vector;
-	temp_command.x1 = x;
-	temp_command.y1 = term->ymax - y;
-
-	wxt_command_push(temp_command);
+	wxt_sigint_init();
+	wxt_current_command_list->push_vertex(x, term->ymax - y);
+	wxt_sigint_check();
+	wxt_sigint_restore();
 }
 
 void wxt_enhanced_flush()
@@ -2022,8 +2113,7 @@ void wxt_enhanced_open(char* fontname, double fontsize, double base, TBOOLEAN wi
 
 	gp_command temp_command;
 	temp_command.command = command_enhanced_open;
-	temp_command.string = new char[strlen(fontname)+1];
-	strcpy(temp_command.string, fontname);
+	wxt_current_command_list->push_string(temp_command, fontname);
 	temp_command.double_value = fontsize;
 	temp_command.double_value2 = base;
 	temp_command.integer_value = overprint;
@@ -2090,9 +2180,7 @@ void wxt_put_text(unsigned int x, unsigned int y, const char * string)
 
 	temp_command.x1 = x;
 	temp_command.y1 = term->ymax - y;
-	/* Note : we must take '\0' (EndOfLine) into account */
-	temp_command.string = new char[strlen(string)+1];
-	strcpy(temp_command.string, string);
+	wxt_current_command_list->push_string(temp_command, string);
 
 	wxt_command_push(temp_command);
 }
@@ -2183,8 +2271,7 @@ int wxt_set_font (const char *font)
 	wxt_sigint_restore();
 
 	/* Note : we must take '\0' (EndOfLine) into account */
-	temp_command.string = new char[strlen(fontname)+1];
-	strcpy(temp_command.string, fontname);
+	wxt_current_command_list->push_string(temp_command, fontname);
 	temp_command.integer_value = fontsize * wxt_set_fontscale;
 
 	wxt_command_push(temp_command);
@@ -2333,14 +2420,11 @@ void wxt_filled_polygon(int n, gpiPoint *corners)
 
 	temp_command.command = command_filled_polygon;
 	temp_command.integer_value = n;
-	temp_command.corners = new gpiPoint[n];
-	/* can't use memcpy() here, as we have to mirror the y axis */
-	gpiPoint *corners_copy = temp_command.corners;
-	while (corners_copy < (temp_command.corners + n)) {
-		*corners_copy = *corners++;
-		corners_copy->y = term->ymax - corners_copy->y;
-		++corners_copy;
-	}
+	wxt_current_command_list->push_points(temp_command, corners, n);
+	/* mirror the y axis of the copy */
+	gpiPoint *corners_copy = wxt_current_command_list->points_of(temp_command);
+	for (int i = 0; i < n; i++)
+		corners_copy[i].y = term->ymax - corners_copy[i].y;
 
 	wxt_command_push(temp_command);
 }
@@ -2438,8 +2522,7 @@ void wxt_hypertext(int type, const char * text)
 
 	temp_command.command = command_hypertext;
 	temp_command.integer_value = type;
-	temp_command.string = new char[strlen(text)+1];
-	strcpy(temp_command.string, text);
+	wxt_current_command_list->push_string(temp_command, text);
 
 	wxt_command_push(temp_command);
 	pending_href = TRUE;
@@ -2632,12 +2715,11 @@ void wxt_modify_plots(unsigned int ops)
  * =================================================================*/
 
 /* push a command in the current commands list */
-void wxt_command_push(gp_command command)
+void wxt_command_push(gp_command &command)
 {
+	/* the pending list is private to the gnuplot thread, no locking needed */
 	wxt_sigint_init();
-	wxt_current_panel->command_list_mutex.Lock();
-	wxt_current_command_list->push_back(command);
-	wxt_current_panel->command_list_mutex.Unlock();
+	wxt_current_command_list->push(command);
 	wxt_sigint_check();
 	wxt_sigint_restore();
 }
@@ -2660,17 +2742,27 @@ void wxtPanel::wxt_cairo_refresh()
 	wxt_display_anchor.x = 0;
 	wxt_display_anchor.y = 0;
 
+	/* Take hold of the displayed list. The mutex is only held while doing so,
+	 * gnuplot may publish a new list while this one is being replayed. */
 	command_list_mutex.Lock();
-	command_list_t::iterator wxt_iter; /*declare the iterator*/
-	for(wxt_iter = command_list.begin(); wxt_iter != command_list.end(); ++wxt_iter) {
+	wxtCommandBuffer *buffer = command_list;
+	buffer->refs++;
+	command_list_mutex.Unlock();
+
+	/* the plots of a multiplot are replayed in the order they were drawn */
+	std::vector<wxtCommandBuffer *> chain;
+	for (wxtCommandBuffer *part = buffer; part; part = part->prefix)
+		chain.push_back(part);
+
+	bool interrupted = false;
+	std::vector<wxtCommandBuffer *>::reverse_iterator part;
+	std::vector<gp_command>::iterator wxt_iter; /*declare the iterator*/
+	for(part = chain.rbegin(); part != chain.rend() && !interrupted; ++part)
+	for(wxt_iter = (*part)->commands.begin(); wxt_iter != (*part)->commands.end(); ++wxt_iter) {
 		if (wxt_status == STATUS_INTERRUPT_ON_NEXT_CHECK) {
 			FPRINTF((stderr,"interrupt detected inside drawing loop\n"));
-#ifdef IMAGE_SURFACE
-			wxt_cairo_create_bitmap();
-#endif /* IMAGE_SURFACE */
-			/* draw the pixmap to the screen */
-			Draw();
-			return;
+			interrupted = true;
+			break;
 		}
 
 		/* Skip the plot commands, but not the key sample commands,
@@ -2682,19 +2774,36 @@ void wxtPanel::wxt_cairo_refresh()
 		&&  wxt_key_boxes[wxt_cur_plotno].hidden)
 			continue;
 
-		wxt_cairo_exec_command( *wxt_iter );
+		wxt_cairo_exec_command( *part, *wxt_iter );
 
 	}
-	command_list_mutex.Unlock();
 
-	/* don't forget to stroke the last path if vector was the last command */
-	gp_cairo_stroke(&plot);
-	/* and don't forget to draw the polygons if draw_polygon was the last command */
-	gp_cairo_end_polygon(&plot);
+	if (!interrupted) {
+		/* don't forget to stroke the last path if vector was the last command */
+		gp_cairo_stroke(&plot);
+		/* and don't forget to draw the polygons if draw_polygon was the last command */
+		gp_cairo_end_polygon(&plot);
 
-	/* If we detected the mouse over a hypertext anchor, draw it now. */
-	if (wxt_display_hypertext)
-		wxt_cairo_draw_hypertext();
+		/* If we detected the mouse over a hypertext anchor, draw it now. */
+		/* The text is stored in the list, so do this before releasing it. */
+		if (wxt_display_hypertext)
+			wxt_cairo_draw_hypertext();
+	}
+	wxt_display_hypertext = NULL;
+
+	/* release the list, delete it if it was replaced in the meantime */
+	command_list_mutex.Lock();
+	ReleaseCommandlist(buffer);
+	command_list_mutex.Unlock();
+
+	if (interrupted) {
+#ifdef IMAGE_SURFACE
+		wxt_cairo_create_bitmap();
+#endif /* IMAGE_SURFACE */
+		/* draw the pixmap to the screen */
+		Draw();
+		return;
+	}
 
 /* the following is a test for a bug in cairo when drawing to a gdkpixmap */
 #if 0
@@ -2781,7 +2890,7 @@ void wxtPanel::wxt_cairo_refresh()
 	Draw();
 
 #if (0)	/* Just for DEBUG */
-	FPRINTF((stderr,"commands done, number of commands %d\n", command_list.size()));
+	FPRINTF((stderr,"commands done, number of commands %d\n", command_list->commands.size()));
 	int ibox;
 	for (ibox=1; ibox<=wxt_max_key_boxes; ibox++) {
 		if (ibox > wxt_cur_plotno) break;
@@ -2794,7 +2903,7 @@ void wxtPanel::wxt_cairo_refresh()
 }
 
 
-void wxtPanel::wxt_cairo_exec_command(gp_command command)
+void wxtPanel::wxt_cairo_exec_command(wxtCommandBuffer *buffer, gp_command &command)
 {
 	static JUSTIFY text_justification_mode = LEFT;
 	static char *current_href = NULL;
@@ -2808,19 +2917,25 @@ void wxtPanel::wxt_cairo_exec_command(gp_command command)
 			wxt_update_key_box(command.x1 - term->h_tic, command.y1 - term->v_tic);
 			wxt_update_key_box(command.x1 + term->h_tic, command.y1 + term->v_tic);
 		}
-		gp_cairo_draw_polygon(&plot, command.integer_value, command.corners);
+		gp_cairo_draw_polygon(&plot, command.integer_value, buffer->points_of(command));
 		return;
 	case command_move :
 		if (wxt_in_key_sample)
 			wxt_update_key_box(command.x1, command.y1);
 		gp_cairo_move(&plot, command.x1, command.y1);
 		return;
-	case command_vector :
-		if (wxt_in_key_sample) {
-			wxt_update_key_box(command.x1, command.y1+term->v_tic);
-			wxt_update_key_box(command.x1, command.y1-term->v_tic);
+	case command_polyline :
+		{
+		gpiPoint *vertex = buffer->points_of(command);
+		gpiPoint *end = vertex + command.integer_value;
+		for (; vertex < end; vertex++) {
+			if (wxt_in_key_sample) {
+				wxt_update_key_box(vertex->x, vertex->y+term->v_tic);
+				wxt_update_key_box(vertex->x, vertex->y-term->v_tic);
+			}
+			gp_cairo_vector(&plot, vertex->x, vertex->y);
+		}
 		}
-		gp_cairo_vector(&plot, command.x1, command.y1);
 		return;
 	case command_linestyle :
 		gp_cairo_set_linestyle(&plot, command.integer_value);
@@ -2832,7 +2947,7 @@ void wxtPanel::wxt_cairo_exec_command(gp_command command)
 		gp_cairo_set_pointsize(&plot, command.double_value);
 		return;
 	case command_hypertext :
-		current_href = command.string;
+		current_href = (char *)buffer->string_of(command);
 		return;
 	case command_point :
 		if (wxt_in_key_sample) {
@@ -2862,12 +2977,12 @@ void wxtPanel::wxt_cairo_exec_command(gp_command command)
 		return;
 	case command_put_text :
 		if (wxt_in_key_sample) {
-			int slen = gp_strlen(command.string) * term->h_char * 0.75;
+			int slen = gp_strlen(buffer->string_of(command)) * term->h_char * 0.75;
 			if (text_justification_mode == RIGHT) slen = -slen;
 			wxt_update_key_box(command.x1, command.y1);
 			wxt_update_key_box(command.x1 + slen, command.y1 - term->v_tic);
 		}
-		gp_cairo_draw_text(&plot, command.x1, command.y1, command.string, NULL, NULL);
+		gp_cairo_draw_text(&plot, command.x1, command.y1, buffer->string_of(command), NULL, NULL);
 		return;
 	case command_enhanced_init :
 		if (wxt_in_key_sample) {
@@ -2885,14 +3000,14 @@ void wxtPanel::wxt_cairo_exec_command(gp_command command)
 		gp_cairo_enhanced_flush(&plot);
 		return;
 	case command_enhanced_open :
-		gp_cairo_enhanced_open(&plot, command.string, command.double_value,
+		gp_cairo_enhanced_open(&plot, (char *)buffer->string_of(command), command.double_value,
 				command.double_value2, command.integer_value2 & 1, (command.integer_value2 & 2) >> 1, command.integer_value);
 		return;
 	case command_enhanced_writec :
 		gp_cairo_enhanced_writec(&plot, command.integer_value);
 		return;
 	case command_set_font :
-		gp_cairo_set_font(&plot, command.string, command.integer_value);
+		gp_cairo_set_font(&plot, buffer->string_of(command), command.integer_value);
 		return;
 	case command_linewidth :
 		gp_cairo_set_linewidth(&plot, command.double_value);;
@@ -99,9 +99,8 @@
 /* wxMemoryInputStream, for the embedded PNG icons */
 #include <wx/mstream.h>
 
-/* c++ vectors and lists, used to store gnuplot commands */
+/* c++ vectors, used to store gnuplot commands */
 #include <vector>
-#include <list>
 
 /* suprisingly Cocoa version of wxWidgets does not define _Bool ! */
 #ifdef __WXOSX_COCOA__
@@ -263,7 +262,7 @@ typedef enum wxt_gp_command_t {
 	command_linetype,
 	command_linestyle,
 	command_move,
-	command_vector,
+	command_polyline,
 	command_put_text,
 	command_enhanced_init,
 	command_enhanced_open,
@@ -286,7 +285,10 @@ typedef enum wxt_gp_command_t {
 #endif
 } wxt_gp_command_t;
 
-/* base structure for storing gnuplot commands */
+/* base structure for storing gnuplot commands.
+ * Variable-size data (strings, polygon corners, polyline vertices) is not
+ * owned by the command itself but stored in the arenas of the enclosing
+ * wxtCommandBuffer, and referenced here by its offset. */
 typedef struct gp_command {
 	enum wxt_gp_command_t command;
 	unsigned int x1;
@@ -301,15 +303,47 @@ typedef struct gp_command {
 	int integer_value2;
 	double double_value;
 	double double_value2;
-	char *string;
-	gpiPoint *corners;
+	size_t offset;
 	enum JUSTIFY mode;
 	rgb_color color;
 	unsigned int * image;
 } gp_command;
 
-/* declare a type for our list of gnuplot commands */
-typedef std::list<gp_command> command_list_t;
+/* Contiguous storage for the commands of one plot.
+ * Commands are kept in a vector, strings and points are appended to
+ * arenas that keep their capacity when the buffer is cleared for the
+ * next plot. Consecutive calls to wxt_vector() are run-length encoded
+ * into a single command_polyline holding integer_value vertices.
+ * In a multiplot, each buffer holds the commands of one plot only, and
+ * refers to the buffer of the plots drawn before it as its prefix. */
+class wxtCommandBuffer
+{
+public :
+	wxtCommandBuffer() : prefix(NULL), refs(1) {}
+	~wxtCommandBuffer() { clear(); }
+
+	void push(const gp_command &command) { commands.push_back(command); }
+	void push_vertex(unsigned int x, unsigned int y);
+	void push_string(gp_command &command, const char *string);
+	void push_points(gp_command &command, const gpiPoint *corners, int n);
+	void clear();
+
+	const char *string_of(const gp_command &command) const
+		{ return &strings[command.offset]; }
+	gpiPoint *points_of(const gp_command &command)
+		{ return &points[command.offset]; }
+
+	std::vector<gp_command> commands;
+	std::vector<char> strings;
+	std::vector<gpiPoint> points;
+
+	/* commands of the earlier plots of a multiplot, replayed first */
+	wxtCommandBuffer *prefix;
+	/* number of holders : the panel, the buffers having this one as their
+	 * prefix and the threads replaying it (protected by the panel's
+	 * command_list_mutex). The buffer is deleted when it drops to 0. */
+	int refs;
+};
 
 /* panel class : this is the space between the toolbar
  * and the status bar, where the plot is actually drawn. */
@@ -344,12 +378,19 @@ public :
 					int hinting_setting);
 	void wxt_settings_apply();
 
-	/* list of commands sent by gnuplot */
-	command_list_t command_list;
-	/* mutex protecting this list */
+	/* commands of the last complete plot, replayed on every refresh */
+	wxtCommandBuffer *command_list;
+	/* commands of the plot being built by gnuplot */
+	wxtCommandBuffer *pending_list;
+	/* mutex protecting the exchange of the two buffers above */
 	wxMutex command_list_mutex;
-	/* method to clear the command list, free the allocated memory */
+	/* method to empty the pending list before a new plot */
 	void ClearCommandlist();
+	/* method to make the pending list the one being displayed,
+	 * and give gnuplot a new pending list to write into */
+	void PublishCommandlist();
+	/* drop a reference to a list, called with command_list_mutex held */
+	static void ReleaseCommandlist(wxtCommandBuffer *buffer);
 
 #ifdef USE_MOUSE
 	/* mouse and zoom events datas */
@@ -377,7 +418,7 @@ public :
 
 	/* functions used to process the command list */
 	void wxt_cairo_refresh();
-	void wxt_cairo_exec_command(gp_command command);
+	void wxt_cairo_exec_command(wxtCommandBuffer *buffer, gp_command &command);
 	void wxt_cairo_draw_hypertext();
 
 	/* the plot structure, defined in gp_cairo.h */
@@ -571,12 +612,12 @@ static wxt_window_t* wxt_findwindowbyid(wxWindowID);
 
 /* pointers to currently active instances */
 static wxt_window_t *wxt_current_window;
-static command_list_t *wxt_current_command_list;
+static wxtCommandBuffer *wxt_current_command_list;
 static wxtPanel *wxt_current_panel;
 static plot_struct *wxt_current_plot;
 
 /* push a command to the commands list */
-static void wxt_command_push(gp_command command);
+static void wxt_command_push(gp_command &command);
 
 #ifdef USE_MOUSE
 /* routine to send an event to gnuplot
@@ -21,6 +21,32 @@ gnuplot.M = function (x,y) {
   } else
     ctx.moveTo(x/10.0,y/10.0);
 }
+// Unpack a run of vertices written by the canvas terminal's "binary" option.
+// The data is a base64 string holding little-endian Int16 (or Float32) x,y
+// pairs; the first vertex is a move and the rest are line segments.
+gnuplot.P = function (data,isfloat) {
+  var bytes = atob(data);
+  var n = bytes.length;
+  var buf = new Uint8Array(n);
+  for (var i = 0; i < n; i++)
+    buf[i] = bytes.charCodeAt(i);
+  var view = new DataView(buf.buffer);
+  var dashed = (gnuplot.pattern.length > 0);
+  var move = dashed ? gnuplot.dashstart : gnuplot.M;
+  var line = dashed ? gnuplot.dashstep : gnuplot.L;
+  var x, y;
+  for (var i = 0; i < n; i += (isfloat ? 8 : 4)) {
+    if (isfloat) {
+      x = view.getFloat32(i,true); y = view.getFloat32(i+4,true);
+    } else {
+      x = view.getInt16(i,true); y = view.getInt16(i+2,true);
+    }
+    if (i == 0)
+      move(x,y);
+    else
+      line(x,y);
+  }
+}
 gnuplot.R = function (x,y,w,h) {
   if (gnuplot.zoomed) {
     var dx, dy, dw, dh;